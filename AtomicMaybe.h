@@ -0,0 +1,406 @@
+#ifndef ATOMIC_MAYBE_H
+#define ATOMIC_MAYBE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#include "Maybe.h"
+#include "MaybeHazard.h"
+
+// A compare-and-swap of two words, done inline rather than through
+// libatomic, lets 8 byte values with no spare bit pattern be stored
+// without boxing them. GCC and Clang provide it on AArch64, and on
+// x86-64 when building with -mcx16.
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)
+#define MAYBE_ATOMIC_WIDE 1
+#else
+#define MAYBE_ATOMIC_WIDE 0
+#endif
+
+namespace Maybe_Detail
+{
+  /*!
+   * How an AtomicMaybe<T> keeps its contents:
+   *
+   * - AtomicFlagged: T and an engaged flag in one atomic word
+   * - AtomicNiche: T alone in one atomic word, with the sentinel from
+   *   maybe_niche<T> meaning empty
+   * - AtomicWide: T and an engaged flag in an atomic pair of words
+   * - AtomicBoxed: a pointer to a heap copy of T, or null
+   */
+  enum AtomicLayout {
+      AtomicFlagged,
+      AtomicNiche,
+      AtomicWide,
+      AtomicBoxed
+  };
+
+  /*!
+   * True when T can be kept as raw bytes in an atomic word. T has to
+   * have no padding, since compare_exchange compares the whole word and
+   * padding bytes copied in with the value are indeterminate: scalars,
+   * and types with unique object representations, qualify.
+   */
+  template <typename T>
+  struct AtomicBytes : std::integral_constant<bool,
+      std::is_trivially_copyable<T>::value && std::is_default_constructible<T>::value &&
+      (std::is_scalar<T>::value || std::has_unique_object_representations<T>::value)> {};
+
+  template <typename T>
+  struct AtomicLayoutOf : std::integral_constant<int,
+      !AtomicBytes<T>::value || (sizeof(T) > sizeof(std::uint64_t)) ? AtomicBoxed :
+      std::atomic<std::uint64_t>::is_always_lock_free && sizeof(T) < sizeof(std::uint64_t) ? AtomicFlagged :
+      std::atomic<std::uint64_t>::is_always_lock_free && maybe_niche<T>::value ? AtomicNiche :
+      MAYBE_ATOMIC_WIDE ? AtomicWide :
+      AtomicBoxed> {};
+}
+
+template <typename T, int Layout = Maybe_Detail::AtomicLayoutOf<T>::value>
+class AtomicMaybe;
+
+/*!
+ * A single Maybe<T> slot which can be shared between threads without a
+ * lock, for handing the latest value from producers to consumers.
+ *
+ *     AtomicMaybe<Quote> latest;
+ *
+ *     //producer
+ *     latest.store(quote);
+ *
+ *     //consumer
+ *     Maybe<Quote> q = latest.take();
+ *     if (q) {
+ *         //got a value, and the slot is now empty
+ *     }
+ *
+ * Small trivially copyable types without padding are packed together
+ * with the engaged flag into one atomic word. At 8 bytes that only
+ * leaves room for the flag when T has a spare value to mean empty (see
+ * maybe_niche), as pointers do; other 8 byte types take a pair of words
+ * where the platform can swap two at once (see MAYBE_ATOMIC_WIDE).
+ * Anything else lives on the heap behind an atomic pointer, and the old
+ * values are freed through hazard pointers once no reader can still be
+ * looking at them.
+ *
+ * All operations are sequentially consistent.
+ */
+template <typename T, int Layout>
+class AtomicMaybe {
+
+    static_assert(Layout == Maybe_Detail::AtomicFlagged || Layout == Maybe_Detail::AtomicNiche,
+                  "the other layouts have their own specializations");
+
+    std::atomic<std::uint64_t> word;
+
+    /*!
+     * Flagged, the value goes in the first sizeof(T) bytes and the flag
+     * in the last one; with a niche, an empty slot holds the sentinel.
+     * Everything else is zeroed. Done byte-wise so it works the same on
+     * either endianness.
+     */
+    static std::uint64_t encode(const Maybe<T>& m) {
+        unsigned char bytes[sizeof(std::uint64_t)] = {};
+        if constexpr (Layout == Maybe_Detail::AtomicNiche) {
+            T value = m ? *m : maybe_niche<T>::empty();
+            std::memcpy(bytes, &value, sizeof(T));
+        } else if (m) {
+            std::memcpy(bytes, m.get_if(), sizeof(T));
+            bytes[sizeof(bytes) - 1] = 1;
+        }
+        std::uint64_t w;
+        std::memcpy(&w, bytes, sizeof(w));
+        return w;
+    }
+
+    static Maybe<T> decode(std::uint64_t w) {
+        unsigned char bytes[sizeof(std::uint64_t)];
+        std::memcpy(bytes, &w, sizeof(w));
+        T value;
+        std::memcpy(&value, bytes, sizeof(T));
+        if constexpr (Layout == Maybe_Detail::AtomicNiche) {
+            return maybe_niche<T>::is_empty(value) ? Maybe<T>() : Maybe<T>(value);
+        } else {
+            return bytes[sizeof(bytes) - 1] ? Maybe<T>(value) : Maybe<T>();
+        }
+    }
+
+public:
+    static constexpr bool is_always_lock_free = true;
+
+    /*!
+     * Constructs an empty slot
+     */
+    AtomicMaybe() : word(encode(Maybe<T>())) {}
+
+    explicit AtomicMaybe(const Maybe<T>& initial) : word(encode(initial)) {}
+
+    AtomicMaybe(const AtomicMaybe&) = delete;
+    AtomicMaybe& operator=(const AtomicMaybe&) = delete;
+
+    bool is_lock_free() const {
+        return true;
+    }
+
+    /*!
+     * Returns a copy of the current contents
+     */
+    Maybe<T> load() const {
+        return decode(word.load());
+    }
+
+    void store(const Maybe<T>& m) {
+        word.store(encode(m));
+    }
+
+    /*!
+     * Replaces the contents, returning what was there before
+     */
+    Maybe<T> exchange(const Maybe<T>& m) {
+        return decode(word.exchange(encode(m)));
+    }
+
+    /*!
+     * Empties the slot, returning what was in it
+     */
+    Maybe<T> take() {
+        return decode(word.exchange(encode(Maybe<T>())));
+    }
+
+    /*!
+     * Stores desired if the slot currently holds expected, and loads
+     * the current contents into expected if it doesn't. Like
+     * std::atomic, values are compared by their object representation.
+     */
+    bool compare_exchange(Maybe<T>& expected, const Maybe<T>& desired) {
+        std::uint64_t e = encode(expected);
+        if (word.compare_exchange_strong(e, encode(desired))) {
+            return true;
+        }
+        expected = decode(e);
+        return false;
+    }
+};
+
+#if MAYBE_ATOMIC_WIDE
+template <typename T>
+class AtomicMaybe<T, Maybe_Detail::AtomicWide> {
+
+    __extension__ typedef unsigned __int128 Pair;
+
+    /*!
+     * The value in the first word and the flag in the second. There is
+     * no two word atomic load, so loads are done as a compare and swap
+     * which leaves the pair as it was, and the pair is mutable for that.
+     */
+    alignas(16) mutable Pair pair;
+
+    static Pair encode(const Maybe<T>& m) {
+        std::uint64_t words[2] = {0, 0};
+        if (m) {
+            std::memcpy(&words[0], m.get_if(), sizeof(T));
+            words[1] = 1;
+        }
+        Pair p;
+        std::memcpy(&p, words, sizeof(p));
+        return p;
+    }
+
+    static Maybe<T> decode(Pair p) {
+        std::uint64_t words[2];
+        std::memcpy(words, &p, sizeof(p));
+        if (!words[1]) {
+            return Maybe<T>();
+        }
+        T value;
+        std::memcpy(&value, &words[0], sizeof(T));
+        return Maybe<T>(value);
+    }
+
+    Pair read() const {
+        return __sync_val_compare_and_swap(&pair, Pair(0), Pair(0));
+    }
+
+    Pair swap(Pair desired) {
+        Pair current = read();
+        for (;;) {
+            Pair seen = __sync_val_compare_and_swap(&pair, current, desired);
+            if (seen == current) {
+                return current;
+            }
+            current = seen;
+        }
+    }
+
+public:
+    static constexpr bool is_always_lock_free = true;
+
+    /*!
+     * Constructs an empty slot
+     */
+    AtomicMaybe() : pair(0) {}
+
+    explicit AtomicMaybe(const Maybe<T>& initial) : pair(encode(initial)) {}
+
+    AtomicMaybe(const AtomicMaybe&) = delete;
+    AtomicMaybe& operator=(const AtomicMaybe&) = delete;
+
+    bool is_lock_free() const {
+        return true;
+    }
+
+    Maybe<T> load() const {
+        return decode(read());
+    }
+
+    void store(const Maybe<T>& m) {
+        swap(encode(m));
+    }
+
+    Maybe<T> exchange(const Maybe<T>& m) {
+        return decode(swap(encode(m)));
+    }
+
+    Maybe<T> take() {
+        return decode(swap(Pair(0)));
+    }
+
+    /*!
+     * As for the single word layouts, values are compared by their
+     * object representation
+     */
+    bool compare_exchange(Maybe<T>& expected, const Maybe<T>& desired) {
+        Pair e = encode(expected);
+        Pair seen = __sync_val_compare_and_swap(&pair, e, encode(desired));
+        if (seen == e) {
+            return true;
+        }
+        expected = decode(seen);
+        return false;
+    }
+};
+#endif
+
+template <typename T>
+class AtomicMaybe<T, Maybe_Detail::AtomicBoxed> {
+
+    std::atomic<T*> slot;
+
+    static T* box(const Maybe<T>& m) {
+        return m ? new T(*m) : nullptr;
+    }
+
+    static T* box(Maybe<T>&& m) {
+        return m ? new T(std::move(*m)) : nullptr;
+    }
+
+    /*!
+     * Turns a value which has just been unlinked from the slot back into
+     * a Maybe. If no reader is looking at it, it is ours alone and can
+     * be moved from and freed straight away. Otherwise it is copied and
+     * retired.
+     */
+    static Maybe<T> unbox(T* p) {
+        if (p == nullptr) {
+            return Maybe<T>();
+        }
+
+        Maybe_Detail::HazardDomain& domain = Maybe_Detail::HazardDomain::instance();
+        if (!domain.isProtected(p)) {
+            Maybe<T> m(std::move(*p));
+            delete p;
+            return m;
+        }
+
+        Maybe<T> m(*p);
+        domain.retire(p);
+        return m;
+    }
+
+public:
+    static constexpr bool is_always_lock_free = std::atomic<T*>::is_always_lock_free;
+
+    /*!
+     * Constructs an empty slot
+     */
+    AtomicMaybe() : slot(nullptr) {}
+
+    explicit AtomicMaybe(Maybe<T> initial) : slot(box(std::move(initial))) {}
+
+    AtomicMaybe(const AtomicMaybe&) = delete;
+    AtomicMaybe& operator=(const AtomicMaybe&) = delete;
+
+    /*!
+     * Frees the current value. No other thread may still be using the
+     * slot.
+     */
+    ~AtomicMaybe() {
+        Maybe_Detail::HazardDomain::instance().retire(slot.load());
+    }
+
+    bool is_lock_free() const {
+        return slot.is_lock_free();
+    }
+
+    /*!
+     * Returns a copy of the current contents
+     */
+    Maybe<T> load() const {
+        Maybe_Detail::HazardGuard guard;
+        T* p = guard.protect(slot);
+        return p != nullptr ? Maybe<T>(*p) : Maybe<T>();
+    }
+
+    void store(Maybe<T> m) {
+        Maybe_Detail::HazardDomain::instance().retire(slot.exchange(box(std::move(m))));
+    }
+
+    /*!
+     * Replaces the contents, returning what was there before
+     */
+    Maybe<T> exchange(Maybe<T> m) {
+        return unbox(slot.exchange(box(std::move(m))));
+    }
+
+    /*!
+     * Empties the slot, returning what was in it
+     */
+    Maybe<T> take() {
+        return unbox(slot.exchange(nullptr));
+    }
+
+    /*!
+     * Stores desired if the slot currently holds a value equal to
+     * expected (by Maybe::operator==), and loads the current contents
+     * into expected if it doesn't.
+     */
+    bool compare_exchange(Maybe<T>& expected, const Maybe<T>& desired) {
+        static_assert(Maybe_Tests::EqualExists<T, T>::value,
+                      "AtomicMaybe::compare_exchange needs an operator== for T, or it could never succeed");
+        Maybe_Detail::HazardGuard guard;
+        T* boxed = nullptr;
+
+        for (;;) {
+            T* current = guard.protect(slot);
+            bool same = current != nullptr ? (expected && Maybe_Detail::doEqualComparison(*current, *expected)) : !expected;
+            if (!same) {
+                expected = current != nullptr ? Maybe<T>(*current) : Maybe<T>();
+                delete boxed;
+                return false;
+            }
+
+            if (boxed == nullptr) {
+                boxed = box(desired);
+            }
+            if (slot.compare_exchange_strong(current, boxed)) {
+                guard.reset();
+                Maybe_Detail::HazardDomain::instance().retire(current);
+                return true;
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,862 @@
+#ifndef EXPECTED_H
+#define EXPECTED_H
+
+#include <cassert>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "Maybe.h"
+
+/*!
+ * Exception thrown when someone tries to extract a value from an
+ * Expected which holds an error.
+ */
+class bad_expected_access : public std::runtime_error {
+public:
+    bad_expected_access() : runtime_error("Attempt to turn an Expected holding an error into a value.") {}
+};
+
+/*!
+ * Wraps an error on its way into an Expected, so it can't be mistaken
+ * for a value:
+ *
+ *     return Unexpected(ParseError::BadDigit);
+ */
+template <typename E>
+class Unexpected {
+
+    E err;
+
+public:
+    template <typename G = E, typename = typename std::enable_if<
+        !std::is_same<typename std::decay<G>::type, Unexpected>::value &&
+        !std::is_same<typename std::decay<G>::type, std::in_place_t>::value &&
+        std::is_constructible<E, G&&>::value>::type>
+    constexpr explicit Unexpected(G&& e) : err(std::forward<G>(e)) {}
+
+    template <typename... Args>
+    constexpr explicit Unexpected(std::in_place_t, Args&&... args) : err(std::forward<Args>(args)...) {}
+
+    constexpr E& error() & noexcept {
+        return err;
+    }
+
+    constexpr const E& error() const& noexcept {
+        return err;
+    }
+
+    constexpr E&& error() && noexcept {
+        return std::move(err);
+    }
+
+    template <typename G>
+    constexpr bool operator==(const Unexpected<G>& other) const {
+        return Maybe_Detail::doEqualComparison(err, other.error());
+    }
+
+    template <typename G>
+    constexpr bool operator!=(const Unexpected<G>& other) const {
+        return !(*this == other);
+    }
+};
+
+template <typename E>
+Unexpected(E) -> Unexpected<E>;
+
+template <typename E>
+constexpr Unexpected<typename std::decay<E>::type> makeUnexpected(E&& e) {
+    return Unexpected<typename std::decay<E>::type>(std::forward<E>(e));
+}
+
+template <typename T, typename E>
+class Expected;
+
+namespace Maybe_Detail
+{
+  [[noreturn]] inline void throwBadExpectedAccess() {
+#if MAYBE_EXCEPTIONS
+      throw bad_expected_access();
+#else
+      std::abort();
+#endif
+  }
+
+  /*!
+   * Tag for building the error in place
+   */
+  struct UnexpectTag {};
+
+  template <typename X>
+  struct IsUnexpected : std::false_type {};
+
+  template <typename E>
+  struct IsUnexpected<Unexpected<E> > : std::true_type {};
+
+  template <typename X>
+  struct IsExpected : std::false_type {};
+
+  template <typename T, typename E>
+  struct IsExpected<Expected<T, E> > : std::true_type {};
+
+  /*!
+   * How many Expecteds deep X is, like MaybeDepth
+   */
+  template <typename X>
+  struct ExpectedDepth : std::integral_constant<int, 0> {};
+
+  template <typename T, typename E>
+  struct ExpectedDepth<Expected<T, E> > : std::integral_constant<int, 1 + ExpectedDepth<T>::value> {};
+
+  /*!
+   * True when a Maybe, Maybe proxy or Expected of type D may be handed
+   * to T's constructor: only when T is itself at least as deep a Maybe
+   * or Expected, and so will take it as one. Any other T would only
+   * find its conversion from bool.
+   */
+  template <typename T, typename D>
+  struct IsWrappable : std::integral_constant<bool,
+      IsMaybe<D>::value ? MaybeDepth<T>::value >= MaybeDepth<D>::value :
+      IsMaybeProxy<D>::value ? MaybeDepth<T>::value >= 1 :
+      IsExpected<D>::value ? ExpectedDepth<T>::value >= ExpectedDepth<D>::value :
+      true> {};
+
+  /*!
+   * True when a single argument of type A should go to one of
+   * Expected's own constructors rather than be forwarded to T. Unlike
+   * Maybe, nullptr is an ordinary value here. Maybes and other
+   * Expecteds are only forwarded to T when it wraps them, as an
+   * Expected<Maybe<int>, E> does a Maybe<int>; otherwise a Maybe needs
+   * an error to go with it, and an Expected of another type goes to the
+   * converting constructors.
+   */
+  template <typename X, typename... A>
+  struct IsExpectedReservedArg : std::false_type {};
+
+  template <typename X, typename A>
+  struct IsExpectedReservedArg<X, A> : std::integral_constant<bool,
+      std::is_same<typename std::decay<A>::type, X>::value ||
+      IsUnexpected<typename std::decay<A>::type>::value ||
+      std::is_same<typename std::decay<A>::type, std::in_place_t>::value ||
+      !IsWrappable<typename X::value_type, typename std::decay<A>::type>::value> {};
+
+  /*!
+   * True when an Expected<T, E> can be made from an O, another Expected
+   * of the same depth, alternative by alternative: T from ValueArg and
+   * E from ErrorArg.
+   */
+  template <typename T, typename E, typename O, typename ValueArg, typename ErrorArg>
+  struct IsExpectedConversion : std::integral_constant<bool,
+      IsExpected<O>::value && !std::is_same<O, Expected<T, E> >::value &&
+      ExpectedDepth<O>::value == ExpectedDepth<Expected<T, E> >::value &&
+      std::is_constructible<T, ValueArg>::value && std::is_constructible<E, ErrorArg>::value> {};
+
+  /*!
+   * The raw members of an Expected, the same layout as inline Maybe
+   * storage with a second alternative in the union. Blank is only ever
+   * seen while a copy or move is being built.
+   */
+  enum ExpectedState : unsigned char { ExpectedBlank, ExpectedValue, ExpectedError };
+
+  template <typename T, typename E,
+            bool = std::is_trivially_destructible<T>::value && std::is_trivially_destructible<E>::value>
+  struct ExpectedData {
+      union {
+          char blank;
+          T value;
+          E error;
+      };
+      ExpectedState state;
+
+      constexpr ExpectedData() : blank(), state(ExpectedBlank) {}
+
+      template <typename... Args>
+      constexpr explicit ExpectedData(std::in_place_t, Args&&... args)
+          : value(std::forward<Args>(args)...), state(ExpectedValue) {}
+
+      template <typename... Args>
+      constexpr explicit ExpectedData(UnexpectTag, Args&&... args)
+          : error(std::forward<Args>(args)...), state(ExpectedError) {}
+
+      ~ExpectedData() {
+          if (state == ExpectedValue) {
+              value.~T();
+          } else if (state == ExpectedError) {
+              error.~E();
+          }
+      }
+  };
+
+  template <typename T, typename E>
+  struct ExpectedData<T, E, true> {
+      union {
+          char blank;
+          T value;
+          E error;
+      };
+      ExpectedState state;
+
+      constexpr ExpectedData() : blank(), state(ExpectedBlank) {}
+
+      template <typename... Args>
+      constexpr explicit ExpectedData(std::in_place_t, Args&&... args)
+          : value(std::forward<Args>(args)...), state(ExpectedValue) {}
+
+      template <typename... Args>
+      constexpr explicit ExpectedData(UnexpectTag, Args&&... args)
+          : error(std::forward<Args>(args)...), state(ExpectedError) {}
+  };
+
+  /*!
+   * Everything Expected storage does, apart from the special members,
+   * which come from the same layers as inline Maybe storage.
+   */
+  template <typename T, typename E>
+  struct ExpectedOps : ExpectedData<T, E> {
+
+      using ExpectedData<T, E>::ExpectedData;
+      using ExpectedData<T, E>::value;
+      using ExpectedData<T, E>::error;
+      using ExpectedData<T, E>::state;
+
+      static constexpr bool nothrowMove =
+          std::is_nothrow_move_constructible<T>::value && std::is_nothrow_move_constructible<E>::value;
+      static constexpr bool nothrowMoveAssign = nothrowMove &&
+          std::is_nothrow_move_assignable<T>::value && std::is_nothrow_move_assignable<E>::value;
+
+      constexpr bool has_value() const {
+          return state == ExpectedValue;
+      }
+
+      constexpr T* get() {
+          return std::addressof(value);
+      }
+
+      constexpr const T* get() const {
+          return std::addressof(value);
+      }
+
+      constexpr E* getError() {
+          return std::addressof(error);
+      }
+
+      constexpr const E* getError() const {
+          return std::addressof(error);
+      }
+
+      /*!
+       * Builds a value or an error in place. The storage must be blank.
+       */
+      template <typename... Args>
+      void constructValue(Args&&... args) {
+          ::new (static_cast<void*>(std::addressof(value))) T(std::forward<Args>(args)...);
+          state = ExpectedValue;
+      }
+
+      template <typename... Args>
+      void constructError(Args&&... args) {
+          ::new (static_cast<void*>(std::addressof(error))) E(std::forward<Args>(args)...);
+          state = ExpectedError;
+      }
+
+      /*!
+       * Destroys whichever alternative is held, leaving the storage blank
+       */
+      void reset() {
+          if (state == ExpectedValue) {
+              value.~T();
+          } else if (state == ExpectedError) {
+              error.~E();
+          }
+          state = ExpectedBlank;
+      }
+
+      void constructFrom(const ExpectedOps& other) {
+          if (other.state == ExpectedValue) {
+              constructValue(other.value);
+          } else if (other.state == ExpectedError) {
+              constructError(other.error);
+          }
+      }
+
+      void constructFrom(ExpectedOps&& other) {
+          if (other.state == ExpectedValue) {
+              constructValue(std::move(other.value));
+          } else if (other.state == ExpectedError) {
+              constructError(std::move(other.error));
+          }
+      }
+
+      /*!
+       * Assigns onto the existing alternative when both sides hold the
+       * same one. Otherwise the old one is destroyed and the new one
+       * built; if that throws, the storage is left blank and may only
+       * be assigned to or destroyed.
+       */
+      template <typename Other>
+      void assign(Other&& other) {
+          if (state == ExpectedValue && other.state == ExpectedValue) {
+              value = std::forward<Other>(other).value;
+          } else if (state == ExpectedError && other.state == ExpectedError) {
+              error = std::forward<Other>(other).error;
+          } else {
+              reset();
+              constructFrom(std::forward<Other>(other));
+          }
+      }
+
+      void swap(ExpectedOps& other) noexcept(nothrowMove &&
+          std::is_nothrow_swappable<T>::value && std::is_nothrow_swappable<E>::value) {
+          using std::swap;
+
+          if (state == ExpectedValue && other.state == ExpectedValue) {
+              swap(value, other.value);
+          } else if (state == ExpectedError && other.state == ExpectedError) {
+              swap(error, other.error);
+          } else {
+              ExpectedOps tmp;
+              tmp.constructFrom(std::move(other));
+              other.reset();
+              other.constructFrom(std::move(*this));
+              reset();
+              constructFrom(std::move(tmp));
+          }
+      }
+  };
+
+  /*!
+   * Whether assigning an X is trivial, and so can be left to the
+   * compiler. Assignment to a union member also needs a trivial
+   * constructor and destructor.
+   */
+  template <typename X>
+  struct TrivialCopyAssign : std::integral_constant<bool,
+      std::is_trivially_copy_constructible<X>::value && std::is_trivially_copy_assignable<X>::value &&
+      std::is_trivially_destructible<X>::value> {};
+
+  template <typename X>
+  struct TrivialMoveAssign : std::integral_constant<bool,
+      std::is_trivially_move_constructible<X>::value && std::is_trivially_move_assignable<X>::value &&
+      std::is_trivially_destructible<X>::value> {};
+
+  template <typename T, typename E>
+  using ExpectedLayers = SpecialMembers<ExpectedOps<T, E>,
+      std::is_trivially_copy_constructible<T>::value && std::is_trivially_copy_constructible<E>::value,
+      std::is_trivially_move_constructible<T>::value && std::is_trivially_move_constructible<E>::value,
+      TrivialCopyAssign<T>::value && TrivialCopyAssign<E>::value,
+      TrivialMoveAssign<T>::value && TrivialMoveAssign<E>::value>;
+
+  template <typename T, typename E>
+  class ExpectedStorage
+      : public ExpectedLayers<T, E>,
+        private EnableCopyConstruct<std::is_copy_constructible<T>::value && std::is_copy_constructible<E>::value>,
+        private EnableMoveConstruct<std::is_move_constructible<T>::value && std::is_move_constructible<E>::value>,
+        private EnableCopyAssign<std::is_copy_constructible<T>::value && std::is_copy_assignable<T>::value &&
+                                 std::is_copy_constructible<E>::value && std::is_copy_assignable<E>::value>,
+        private EnableMoveAssign<std::is_move_constructible<T>::value && std::is_move_assignable<T>::value &&
+                                 std::is_move_constructible<E>::value && std::is_move_assignable<E>::value> {
+
+      typedef ExpectedLayers<T, E> Layers;
+
+  public:
+      using Layers::Layers;
+  };
+}
+
+/*!
+ * Either a T, or an E saying why there isn't one. It is Maybe's
+ * counterpart for failures that need explaining, and is built on the
+ * same inline storage, so an Expected of trivial types is itself
+ * trivially copyable and nothing is ever allocated.
+ *
+ * Errors travel back by value, and none of the combinators throw, so
+ * failure costs no more than success:
+ *
+ *     Expected<int, ParseError> parseInt(std::string_view s);
+ *
+ *     Expected<Port, ParseError> port = parseInt(text)
+ *         .and_then(checkRange)
+ *         .map([](int n) { return Port(n); });
+ *
+ *     if (!port) {
+ *         log(port.error());
+ *     }
+ *
+ * It converts to a Maybe<T> with to_maybe(), which drops the error, and
+ * is made from a Maybe<T> by giving the error to use if it is empty.
+ */
+template <typename T, typename E>
+class Expected {
+
+    template <typename, typename>
+    friend class Expected;
+
+    static_assert(!std::is_reference<T>::value && !std::is_reference<E>::value,
+                  "Expected cannot hold references");
+
+    Maybe_Detail::ExpectedStorage<T, E> storage;
+
+public:
+    typedef T value_type;
+    typedef E error_type;
+
+    /*!
+     * Constructs an Expected holding a value, by forwarding the args to
+     * T's constructor. With no args that is a value initialized T.
+     */
+    template <typename... Ts, typename = typename std::enable_if<
+        !Maybe_Detail::IsExpectedReservedArg<Expected, Ts...>::value &&
+        std::is_constructible<T, Ts&&...>::value>::type>
+    constexpr Expected(Ts&&... args) : storage(std::in_place, std::forward<Ts>(args)...) {}
+
+    template <typename... Ts>
+    constexpr explicit Expected(std::in_place_t, Ts&&... args) : storage(std::in_place, std::forward<Ts>(args)...) {}
+
+    /*!
+     * Constructs an Expected holding an error
+     */
+    template <typename G, typename = typename std::enable_if<std::is_constructible<E, const G&>::value>::type>
+    constexpr Expected(const Unexpected<G>& e) : storage(Maybe_Detail::UnexpectTag(), e.error()) {}
+
+    template <typename G, typename = typename std::enable_if<std::is_constructible<E, G&&>::value>::type>
+    constexpr Expected(Unexpected<G>&& e) : storage(Maybe_Detail::UnexpectTag(), std::move(e).error()) {}
+
+    /*!
+     * Takes m's value, or errorIfEmpty if it doesn't have one
+     */
+    template <typename Policy, typename G>
+    Expected(const Maybe<T, Policy>& m, G&& errorIfEmpty) {
+        if (m) {
+            storage.constructValue(*m);
+        } else {
+            storage.constructError(std::forward<G>(errorIfEmpty));
+        }
+    }
+
+    template <typename Policy, typename G>
+    Expected(Maybe<T, Policy>&& m, G&& errorIfEmpty) {
+        if (m) {
+            storage.constructValue(std::move(*m));
+        } else {
+            storage.constructError(std::forward<G>(errorIfEmpty));
+        }
+    }
+
+    Expected(const Expected& other) = default;
+    Expected(Expected&& other) = default;
+    Expected& operator=(const Expected& other) = default;
+    Expected& operator=(Expected&& other) = default;
+
+    /*!
+     * Converts from an Expected of other types, building T from its value
+     * or E from its error. Explicit unless both convert implicitly.
+     */
+    template <typename U, typename G, typename std::enable_if<
+        Maybe_Detail::IsExpectedConversion<T, E, Expected<U, G>, const U&, const G&>::value &&
+        std::is_convertible<const U&, T>::value && std::is_convertible<const G&, E>::value, int>::type = 0>
+    Expected(const Expected<U, G>& other) {
+        constructFrom(other);
+    }
+
+    template <typename U, typename G, typename std::enable_if<
+        Maybe_Detail::IsExpectedConversion<T, E, Expected<U, G>, const U&, const G&>::value &&
+        !(std::is_convertible<const U&, T>::value && std::is_convertible<const G&, E>::value), int>::type = 0>
+    explicit Expected(const Expected<U, G>& other) {
+        constructFrom(other);
+    }
+
+    template <typename U, typename G, typename std::enable_if<
+        Maybe_Detail::IsExpectedConversion<T, E, Expected<U, G>, U&&, G&&>::value &&
+        std::is_convertible<U&&, T>::value && std::is_convertible<G&&, E>::value, int>::type = 0>
+    Expected(Expected<U, G>&& other) {
+        constructFrom(std::move(other));
+    }
+
+    template <typename U, typename G, typename std::enable_if<
+        Maybe_Detail::IsExpectedConversion<T, E, Expected<U, G>, U&&, G&&>::value &&
+        !(std::is_convertible<U&&, T>::value && std::is_convertible<G&&, E>::value), int>::type = 0>
+    explicit Expected(Expected<U, G>&& other) {
+        constructFrom(std::move(other));
+    }
+
+    /*!
+     * Assigns from an Expected of other types, onto the existing
+     * alternative when both hold the same one
+     */
+    template <typename U, typename G, typename = typename std::enable_if<
+        Maybe_Detail::IsExpectedConversion<T, E, Expected<U, G>, const U&, const G&>::value &&
+        std::is_assignable<T&, const U&>::value && std::is_assignable<E&, const G&>::value>::type>
+    Expected& operator=(const Expected<U, G>& other) {
+        assignFrom(other);
+        return *this;
+    }
+
+    template <typename U, typename G, typename = typename std::enable_if<
+        Maybe_Detail::IsExpectedConversion<T, E, Expected<U, G>, U&&, G&&>::value &&
+        std::is_assignable<T&, U&&>::value && std::is_assignable<E&, G&&>::value>::type>
+    Expected& operator=(Expected<U, G>&& other) {
+        assignFrom(std::move(other));
+        return *this;
+    }
+
+    /*!
+     * Assigns a value, onto the existing one if there is one
+     */
+    template <typename O, typename = typename std::enable_if<
+        !Maybe_Detail::IsExpectedReservedArg<Expected, O>::value &&
+        std::is_constructible<T, O&&>::value && std::is_assignable<T&, O&&>::value>::type>
+    Expected& operator=(O&& other) {
+        if (storage.has_value()) {
+            *storage.get() = std::forward<O>(other);
+        } else {
+            storage.reset();
+            storage.constructValue(std::forward<O>(other));
+        }
+
+        return *this;
+    }
+
+    /*!
+     * Assigns an error, onto the existing one if there is one
+     */
+    template <typename G>
+    Expected& operator=(const Unexpected<G>& e) {
+        if (!storage.has_value()) {
+            *storage.getError() = e.error();
+        } else {
+            storage.reset();
+            storage.constructError(e.error());
+        }
+
+        return *this;
+    }
+
+    template <typename G>
+    Expected& operator=(Unexpected<G>&& e) {
+        if (!storage.has_value()) {
+            *storage.getError() = std::move(e).error();
+        } else {
+            storage.reset();
+            storage.constructError(std::move(e).error());
+        }
+
+        return *this;
+    }
+
+    /*!
+     * Destroys whatever is held and builds a new value in place from args
+     */
+    template <typename... Ts>
+    T& emplace(Ts&&... args) {
+        storage.reset();
+        storage.constructValue(std::forward<Ts>(args)...);
+
+        return *storage.get();
+    }
+
+    void swap(Expected& other) noexcept(noexcept(storage.swap(other.storage))) {
+        storage.swap(other.storage);
+    }
+
+    /*!
+     * Checks if this Expected holds a value rather than an error
+     */
+    constexpr operator bool() const noexcept {
+        return storage.has_value();
+    }
+
+    constexpr bool has_value() const noexcept {
+        return storage.has_value();
+    }
+
+    /*!
+     * Extracts the value, and throws a bad_expected_access if there is
+     * an error instead
+     */
+    constexpr T& operator()() {
+        if (storage.has_value()) return *storage.get();
+        Maybe_Detail::throwBadExpectedAccess();
+    }
+
+    constexpr const T& operator()() const {
+        if (storage.has_value()) return *storage.get();
+        Maybe_Detail::throwBadExpectedAccess();
+    }
+
+    /*!
+     * Extracts the value without checking for it. Debug builds assert on
+     * it.
+     */
+    constexpr T& operator*() & noexcept {
+        assert(storage.has_value());
+        return *storage.get();
+    }
+
+    constexpr const T& operator*() const& noexcept {
+        assert(storage.has_value());
+        return *storage.get();
+    }
+
+    constexpr T&& operator*() && noexcept {
+        assert(storage.has_value());
+        return std::move(*storage.get());
+    }
+
+    constexpr T* operator->() noexcept {
+        assert(storage.has_value());
+        return storage.get();
+    }
+
+    constexpr const T* operator->() const noexcept {
+        assert(storage.has_value());
+        return storage.get();
+    }
+
+    /*!
+     * The error, without checking for it. Debug builds assert on it.
+     */
+    constexpr E& error() & noexcept {
+        assert(!storage.has_value());
+        return *storage.getError();
+    }
+
+    constexpr const E& error() const& noexcept {
+        assert(!storage.has_value());
+        return *storage.getError();
+    }
+
+    constexpr E&& error() && noexcept {
+        assert(!storage.has_value());
+        return std::move(*storage.getError());
+    }
+
+    /*!
+     * Returns a pointer to the value, or a null pointer if there is an
+     * error instead
+     */
+    constexpr T* get_if() noexcept {
+        return storage.has_value() ? storage.get() : nullptr;
+    }
+
+    constexpr const T* get_if() const noexcept {
+        return storage.has_value() ? storage.get() : nullptr;
+    }
+
+    template <typename U>
+    constexpr T value_or(U&& def) const& {
+        return storage.has_value() ? *storage.get() : static_cast<T>(std::forward<U>(def));
+    }
+
+    template <typename U>
+    constexpr T value_or(U&& def) && {
+        return storage.has_value() ? std::move(*storage.get()) : static_cast<T>(std::forward<U>(def));
+    }
+
+    /*!
+     * The value as a Maybe, dropping the error if there is one
+     */
+    constexpr Maybe<T> to_maybe() const& {
+        return storage.has_value() ? Maybe<T>(std::in_place, *storage.get()) : Maybe<T>();
+    }
+
+    constexpr Maybe<T> to_maybe() && {
+        return storage.has_value() ? Maybe<T>(std::in_place, std::move(*storage.get())) : Maybe<T>();
+    }
+
+    /*!
+     * Monadic operations, the same as Maybe's. Each passes the value (or
+     * the error) on as an lvalue, const lvalue or rvalue to match the
+     * Expected it was called on; whichever side f doesn't take is
+     * carried through unchanged.
+     */
+
+    /*!
+     * Applies f to the value, giving an Expected of whatever f returns
+     */
+    template <typename F>
+    constexpr auto map(F&& f) & {
+        return mapImpl(*this, std::forward<F>(f));
+    }
+
+    template <typename F>
+    constexpr auto map(F&& f) const& {
+        return mapImpl(*this, std::forward<F>(f));
+    }
+
+    template <typename F>
+    constexpr auto map(F&& f) && {
+        return mapImpl(std::move(*this), std::forward<F>(f));
+    }
+
+    /*!
+     * Applies f, which itself returns an Expected with the same error
+     * type, to the value
+     */
+    template <typename F>
+    constexpr auto and_then(F&& f) & {
+        return andThenImpl(*this, std::forward<F>(f));
+    }
+
+    template <typename F>
+    constexpr auto and_then(F&& f) const& {
+        return andThenImpl(*this, std::forward<F>(f));
+    }
+
+    template <typename F>
+    constexpr auto and_then(F&& f) && {
+        return andThenImpl(std::move(*this), std::forward<F>(f));
+    }
+
+    /*!
+     * Applies f to the error, giving an Expected with whatever error
+     * type f returns
+     */
+    template <typename F>
+    constexpr auto map_error(F&& f) const& {
+        return mapErrorImpl(*this, std::forward<F>(f));
+    }
+
+    template <typename F>
+    constexpr auto map_error(F&& f) && {
+        return mapErrorImpl(std::move(*this), std::forward<F>(f));
+    }
+
+    /*!
+     * Returns this Expected if it has a value, and otherwise whatever f
+     * returns for the error, which must be an Expected of the same T
+     */
+    template <typename F>
+    constexpr auto or_else(F&& f) const& {
+        return orElseImpl(*this, std::forward<F>(f));
+    }
+
+    template <typename F>
+    constexpr auto or_else(F&& f) && {
+        return orElseImpl(std::move(*this), std::forward<F>(f));
+    }
+
+private:
+    /*!
+     * Builds whichever alternative other, an Expected of other types,
+     * holds. The storage must be blank.
+     */
+    template <typename Other>
+    void constructFrom(Other&& other) {
+        if (other) {
+            storage.constructValue(*std::forward<Other>(other));
+        } else {
+            storage.constructError(std::forward<Other>(other).error());
+        }
+    }
+
+    template <typename Other>
+    void assignFrom(Other&& other) {
+        if (other && storage.has_value()) {
+            *storage.get() = *std::forward<Other>(other);
+        } else if (!other && !storage.has_value()) {
+            *storage.getError() = std::forward<Other>(other).error();
+        } else {
+            storage.reset();
+            constructFrom(std::forward<Other>(other));
+        }
+    }
+
+    template <typename Self>
+    static constexpr decltype(auto) forwardError(Self&& self) {
+        typedef typename std::conditional<std::is_lvalue_reference<Self>::value, const E&, E&&>::type Ref;
+        return static_cast<Ref>(*self.storage.getError());
+    }
+
+    template <typename Self, typename F>
+    static constexpr auto mapImpl(Self&& self, F&& f) {
+        typedef decltype(*std::forward<Self>(self)) Arg;
+        typedef typename std::remove_cv<typename std::remove_reference<
+            typename std::invoke_result<F, Arg>::type>::type>::type U;
+        static_assert(!std::is_void<U>::value, "Expected::map needs a function which returns a value");
+
+        if (!self) {
+            return Expected<U, E>(Unexpected<E>(std::in_place, forwardError(self)));
+        }
+        return Expected<U, E>(std::in_place, std::forward<F>(f)(*std::forward<Self>(self)));
+    }
+
+    template <typename Self, typename F>
+    static constexpr auto andThenImpl(Self&& self, F&& f) {
+        typedef decltype(*std::forward<Self>(self)) Arg;
+        typedef typename std::remove_cv<typename std::remove_reference<
+            typename std::invoke_result<F, Arg>::type>::type>::type R;
+        static_assert(Maybe_Detail::IsExpected<R>::value, "Expected::and_then needs a function which returns an Expected");
+        static_assert(std::is_same<typename R::error_type, E>::value, "Expected::and_then needs a function with the same error type");
+
+        if (!self) {
+            return R(Unexpected<E>(std::in_place, forwardError(self)));
+        }
+        return R(std::forward<F>(f)(*std::forward<Self>(self)));
+    }
+
+    template <typename Self, typename F>
+    static constexpr auto mapErrorImpl(Self&& self, F&& f) {
+        typedef typename std::remove_cv<typename std::remove_reference<
+            typename std::invoke_result<F, decltype(forwardError(self))>::type>::type>::type G;
+        static_assert(!std::is_void<G>::value, "Expected::map_error needs a function which returns a value");
+
+        if (self) {
+            return Expected<T, G>(std::in_place, *std::forward<Self>(self));
+        }
+        return Expected<T, G>(Unexpected<G>(std::in_place, std::forward<F>(f)(forwardError(self))));
+    }
+
+    template <typename Self, typename F>
+    static constexpr auto orElseImpl(Self&& self, F&& f) {
+        typedef typename std::remove_cv<typename std::remove_reference<
+            typename std::invoke_result<F, decltype(forwardError(self))>::type>::type>::type R;
+        static_assert(Maybe_Detail::IsExpected<R>::value, "Expected::or_else needs a function which returns an Expected");
+        static_assert(std::is_same<typename R::value_type, T>::value, "Expected::or_else needs a function with the same value type");
+
+        if (self) {
+            return R(std::in_place, *std::forward<Self>(self));
+        }
+        return R(std::forward<F>(f)(forwardError(self)));
+    }
+
+public:
+    /*!
+     * Two Expecteds are equal when both hold equal values, or both hold
+     * equal errors
+     */
+    template <typename oT, typename oE>
+    constexpr bool operator==(const Expected<oT, oE>& other) const {
+        if (storage.has_value() != other.storage.has_value()) {
+            return false;
+        }
+        if (storage.has_value()) {
+            return Maybe_Detail::doEqualComparison(*storage.get(), *other.storage.get());
+        }
+        return Maybe_Detail::doEqualComparison(*storage.getError(), *other.storage.getError());
+    }
+
+    template <typename oT, typename oE>
+    constexpr bool operator!=(const Expected<oT, oE>& other) const {
+        return !(*this == other);
+    }
+
+    /*!
+     * Checks for an error equal to the one in e
+     */
+    template <typename G>
+    constexpr bool operator==(const Unexpected<G>& e) const {
+        return !storage.has_value() && Maybe_Detail::doEqualComparison(*storage.getError(), e.error());
+    }
+
+    template <typename G>
+    constexpr bool operator!=(const Unexpected<G>& e) const {
+        return !(*this == e);
+    }
+};
+
+template <typename T, typename E>
+void swap(Expected<T, E>& a, Expected<T, E>& b) noexcept(noexcept(a.swap(b))) {
+    a.swap(b);
+}
+
+#endif
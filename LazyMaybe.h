@@ -0,0 +1,329 @@
+#ifndef LAZY_MAYBE_H
+#define LAZY_MAYBE_H
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "Maybe.h"
+
+/*!
+ * Policy for a LazyMaybe used from one thread at a time. The first use
+ * runs the factory with no synchronisation at all.
+ */
+struct MaybeSingleThreaded {};
+
+/*!
+ * Policy for a LazyMaybe which may be read from several threads at
+ * once. The factory runs exactly once, and readers that arrive while it
+ * runs wait for it to finish.
+ */
+struct MaybeThreadSafe {};
+
+namespace Maybe_Detail
+{
+  /*!
+   * Whether a LazyMaybe has run its factory yet
+   */
+  template <typename Policy>
+  class LazyState;
+
+  template <>
+  class LazyState<MaybeSingleThreaded> {
+
+      bool done;
+
+  public:
+      explicit LazyState(bool done) : done(done) {}
+
+      bool isDone() const {
+          return done;
+      }
+
+      template <typename F>
+      void runOnce(F&& f) {
+          if (!done) {
+              std::forward<F>(f)();
+              done = true;
+          }
+      }
+  };
+
+  template <>
+  class LazyState<MaybeThreadSafe> {
+
+      enum : unsigned char { Pending, Running, Done };
+
+      std::atomic<unsigned char> state;
+
+  public:
+      explicit LazyState(bool done) : state(done ? Done : Pending) {}
+
+      LazyState(const LazyState& other) : state(other.isDone() ? Done : Pending) {}
+
+      LazyState& operator=(const LazyState& other) {
+          state.store(other.isDone() ? Done : Pending, std::memory_order_release);
+          return *this;
+      }
+
+      bool isDone() const {
+          return state.load(std::memory_order_acquire) == Done;
+      }
+
+      /*!
+       * Runs f if no other thread has, or waits for the one that is. If
+       * f throws, the next caller gets to try again.
+       */
+      template <typename F>
+      void runOnce(F&& f) {
+          for (;;) {
+              unsigned char s = Pending;
+              if (state.compare_exchange_strong(s, Running, std::memory_order_acquire)) {
+#if MAYBE_EXCEPTIONS
+                  try {
+                      std::forward<F>(f)();
+                  } catch (...) {
+                      state.store(Pending, std::memory_order_release);
+                      throw;
+                  }
+#else
+                  std::forward<F>(f)();
+#endif
+                  state.store(Done, std::memory_order_release);
+                  return;
+              }
+              if (s == Done) {
+                  return;
+              }
+              std::this_thread::yield();
+          }
+      }
+  };
+}
+
+/*!
+ * A Maybe<T> whose contents are worked out by a factory the first time
+ * anyone looks at them, then kept. If nobody ever asks, the factory
+ * never runs.
+ *
+ *     LazyMaybe<Geo> geo([&] { return lookupGeo(request.ip); });
+ *
+ *     if (needsGeo && geo) {
+ *         //lookupGeo ran just now, and only this once
+ *         use(geo());
+ *     }
+ *
+ * The factory returns either a Maybe<T> or something a T can be built
+ * from, in which case the result always has a value. The result is kept
+ * in an inline Maybe<T>.
+ *
+ * Testing, extracting and comparing all run the factory first. A
+ * LazyMaybe is a Maybe proxy, so it converts to a Maybe<T> and compares
+ * with Maybes and other proxies like a Maybe would. With
+ * MaybeThreadSafe it may be read from several threads at once.
+ */
+template <typename T, typename Policy = MaybeSingleThreaded>
+class LazyMaybe {
+
+    typedef std::function<Maybe<T>()> Factory;
+
+    mutable Maybe<T> value;
+    Factory factory;
+    mutable Maybe_Detail::LazyState<Policy> state;
+
+    template <typename F>
+    static Factory wrap(F&& f) {
+        typedef typename std::remove_cv<typename std::remove_reference<
+            typename std::invoke_result<F&>::type>::type>::type R;
+
+        if constexpr (std::is_same<R, Maybe<T> >::value) {
+            return Factory(std::forward<F>(f));
+        } else {
+            return [f = std::forward<F>(f)]() mutable { return Maybe<T>(std::in_place, f()); };
+        }
+    }
+
+    /*!
+     * Runs the factory if it hasn't run yet
+     */
+    const Maybe<T>& force() const {
+        if (!state.isDone()) {
+            state.runOnce([this] { value = factory(); });
+        }
+        return value;
+    }
+
+public:
+    typedef T maybe_proxy_of;
+
+    /*!
+     * Constructs a LazyMaybe which is already known to be empty
+     */
+    LazyMaybe() : state(true) {}
+
+    LazyMaybe(const std::nullptr_t&) : state(true) {}
+
+    /*!
+     * Constructs a LazyMaybe which is already known to hold m's contents
+     */
+    LazyMaybe(const Maybe<T>& m) : value(m), state(true) {}
+
+    LazyMaybe(Maybe<T>&& m) : value(std::move(m)), state(true) {}
+
+    /*!
+     * Constructs a LazyMaybe which will call f on first use. Maybes and
+     * Maybe proxies are invocable too, through their checked
+     * operator()(), but are never taken as factories: they go to the
+     * constructors above.
+     */
+    template <typename F, typename = typename std::enable_if<
+        !std::is_same<typename std::decay<F>::type, LazyMaybe>::value &&
+        !Maybe_Detail::IsMaybe<typename std::decay<F>::type>::value &&
+        !Maybe_Detail::IsMaybeProxy<typename std::decay<F>::type>::value &&
+        std::is_invocable<F&>::value>::type>
+    explicit LazyMaybe(F&& f) : factory(wrap(std::forward<F>(f))), state(false) {}
+
+    /*!
+     * Copies the result if other has one, and otherwise the factory, so
+     * the copy is still lazy
+     */
+    LazyMaybe(const LazyMaybe& other) : state(other.state.isDone()) {
+        if (other.state.isDone()) {
+            value = other.value;
+        } else {
+            factory = other.factory;
+        }
+    }
+
+    /*!
+     * Takes other's result or factory. other is left evaluated, holding
+     * whatever moving its result left behind.
+     */
+    LazyMaybe(LazyMaybe&& other) : value(std::move(other.value)), factory(std::move(other.factory)), state(other.state) {
+        other.state = Maybe_Detail::LazyState<Policy>(true);
+    }
+
+    LazyMaybe& operator=(const LazyMaybe& other) {
+        if (this != &other) {
+            LazyMaybe copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    LazyMaybe& operator=(LazyMaybe&& other) {
+        value = std::move(other.value);
+        factory = std::move(other.factory);
+        state = other.state;
+        if (this != &other) {
+            other.state = Maybe_Detail::LazyState<Policy>(true);
+        }
+        return *this;
+    }
+
+    /*!
+     * Replaces the contents and drops the factory, if it never ran
+     */
+    LazyMaybe& operator=(const Maybe<T>& m) {
+        value = m;
+        factory = nullptr;
+        state = Maybe_Detail::LazyState<Policy>(true);
+        return *this;
+    }
+
+    LazyMaybe& operator=(const std::nullptr_t&) {
+        return *this = Maybe<T>();
+    }
+
+    /*!
+     * Checks if the factory has run
+     */
+    bool evaluated() const {
+        return state.isDone();
+    }
+
+    /*!
+     * The result, running the factory if needed
+     */
+    const Maybe<T>& get() const {
+        return force();
+    }
+
+    /*!
+     * Checks if value can be extracted from this Maybe
+     */
+    operator bool() const {
+        return static_cast<bool>(force());
+    }
+
+    /*!
+     * Extracts the value, and throws an exception if we can't
+     */
+    const T& operator()() const {
+        return force()();
+    }
+
+    /*!
+     * Extracts the value without checking for it
+     */
+    const T& operator*() const {
+        return *force();
+    }
+
+    const T* operator->() const {
+        return force().operator->();
+    }
+
+    const T* get_if() const {
+        return force().get_if();
+    }
+
+    template <typename U>
+    T value_or(U&& def) const {
+        return force().value_or(std::forward<U>(def));
+    }
+
+    /*!
+     * Copies the result out into a Maybe
+     */
+    operator Maybe<T>() const {
+        return force();
+    }
+
+    /*!
+     * Compares like Maybe::operator==, against any Maybe proxy
+     */
+    template <typename R, typename = typename std::enable_if<Maybe_Detail::IsMaybeProxy<R>::value>::type>
+    bool operator==(const R& other) const {
+        return Maybe_Detail::equalMaybes<T, typename R::maybe_proxy_of>(force(), other);
+    }
+
+    template <typename R, typename = typename std::enable_if<Maybe_Detail::IsMaybeProxy<R>::value>::type>
+    bool operator!=(const R& other) const {
+        return !(*this == other);
+    }
+
+    template <typename oT, typename oPolicy>
+    friend bool operator==(const LazyMaybe& a, const Maybe<oT, oPolicy>& b) {
+        return a.force() == b;
+    }
+
+    template <typename oT, typename oPolicy>
+    friend bool operator==(const Maybe<oT, oPolicy>& a, const LazyMaybe& b) {
+        return a == b.force();
+    }
+
+    template <typename oT, typename oPolicy>
+    friend bool operator!=(const LazyMaybe& a, const Maybe<oT, oPolicy>& b) {
+        return !(a == b);
+    }
+
+    template <typename oT, typename oPolicy>
+    friend bool operator!=(const Maybe<oT, oPolicy>& a, const LazyMaybe& b) {
+        return !(a == b);
+    }
+};
+
+#endif
@@ -1,20 +1,44 @@
 #ifndef MAYBE_H
 #define MAYBE_H
 
+#include <cassert>
+#include <cstdlib>
+#include <functional>
 #include <stdexcept>
+#include <string>
+#include <string_view>
 #include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
 
-// operator== check from https://stackoverflow.com/questions/6534041/how-to-check-whether-operator-exists
+#if defined(__cpp_lib_three_way_comparison) && __cpp_lib_three_way_comparison >= 201907L
+#include <compare>
+#endif
+
+// Checks whether a const T and a const Arg can be compared with ==.
+// With concepts it is a single requires-expression, and otherwise the
+// void_t detection idiom; neither needs a catch-all operator== that
+// every comparison in the program would have to be weighed against.
 namespace Maybe_Tests
 {
-  struct No {};
-  template<typename T, typename Arg> No operator== (const T&, const Arg&);
+#if defined(__cpp_concepts) && __cpp_concepts >= 201907L
+  template<typename T, typename Arg>
+  concept EqualityComparableWith = requires(const T& a, const Arg& b) { a == b; };
 
   template<typename T, typename Arg = T>
-  struct EqualExists
-  {
-    enum { value = !std::is_same<decltype(*(T*)(0) == *(Arg*)(0)), No>::value };
-  };
+  struct EqualExists : std::bool_constant<EqualityComparableWith<T, Arg> > {};
+#else
+  template<typename T, typename Arg, typename = void>
+  struct EqualExistsImpl : std::false_type {};
+
+  template<typename T, typename Arg>
+  struct EqualExistsImpl<T, Arg, std::void_t<decltype(std::declval<const T&>() == std::declval<const Arg&>())> >
+      : std::true_type {};
+
+  template<typename T, typename Arg = T>
+  struct EqualExists : EqualExistsImpl<T, Arg> {};
+#endif
 }
 
 /*!
@@ -25,12 +49,1039 @@ public:
     null_maybe_exception() : runtime_error("Atempt to turn a null Maybe into a value.") {}
 };
 
+// Builds with -fno-exceptions get std::abort() wherever a Maybe would
+// otherwise throw.
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define MAYBE_EXCEPTIONS 1
+#else
+#define MAYBE_EXCEPTIONS 0
+#endif
+
+// Building with MAYBE_INSTRUMENTATION=1 counts constructions, copies,
+// moves, boxed allocations and reads of empty Maybes per payload type;
+// see MaybeStats.h for reading the counts back. Otherwise MAYBE_RECORD
+// expands to nothing and MaybeStats.h is never included.
+#ifndef MAYBE_INSTRUMENTATION
+#define MAYBE_INSTRUMENTATION 0
+#endif
+
+#if MAYBE_INSTRUMENTATION
+#include "MaybeStats.h"
+
+// Constant evaluation can't touch the counters, so it is skipped where
+// the compiler can tell us about it.
+#if defined(__cpp_lib_is_constant_evaluated)
+#define MAYBE_CONSTANT_EVALUATED() std::is_constant_evaluated()
+#elif defined(__GNUC__) && (__GNUC__ >= 9 || defined(__clang__))
+#define MAYBE_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#else
+#define MAYBE_CONSTANT_EVALUATED() false
+#endif
+
+#define MAYBE_RECORD(T, Policy, counter, n) \
+    (MAYBE_CONSTANT_EVALUATED() ? (void)0 : MaybeStats::record<T, Policy>(MaybeStats::counter, n))
+#else
+#define MAYBE_RECORD(T, Policy, counter, n) ((void)0)
+#endif
+
+// Building with MAYBE_DEBUG_CHECKS=1 makes boxed Maybes keep track of
+// whether they hold a value separately from their pointer, remember
+// where they were last emptied, and check both on every access, so a
+// read of a reset or destroyed Maybe stops the program with stack traces
+// instead of quietly reading freed memory. It changes the size of boxed
+// Maybes, so the whole program needs the same setting. Otherwise it adds
+// nothing at all.
+#ifndef MAYBE_DEBUG_CHECKS
+#define MAYBE_DEBUG_CHECKS 0
+#endif
+
+#if MAYBE_DEBUG_CHECKS
+#include <cstdio>
+#if defined(__has_include)
+#if __has_include(<execinfo.h>)
+#include <execinfo.h>
+#define MAYBE_BACKTRACE 1
+#endif
+#endif
+#endif
+
+#ifndef MAYBE_BACKTRACE
+#define MAYBE_BACKTRACE 0
+#endif
+
+// Under AddressSanitizer, memory which allocators here keep hold of
+// after it is freed (slab free lists, arena blocks) is poisoned, so
+// stale reads through it are reported like any other use after free.
+#if defined(__SANITIZE_ADDRESS__)
+#define MAYBE_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define MAYBE_ASAN 1
+#endif
+#endif
+
+#ifndef MAYBE_ASAN
+#define MAYBE_ASAN 0
+#endif
+
+#if MAYBE_ASAN
+#include <sanitizer/asan_interface.h>
+#define MAYBE_POISON(p, n) ASAN_POISON_MEMORY_REGION(p, n)
+#define MAYBE_UNPOISON(p, n) ASAN_UNPOISON_MEMORY_REGION(p, n)
+#else
+#define MAYBE_POISON(p, n) ((void)(p), (void)(n))
+#define MAYBE_UNPOISON(p, n) ((void)(p), (void)(n))
+#endif
+
+namespace Maybe_Detail
+{
+  /*!
+   * Reports an attempt to read an empty Maybe. Kept out of line of the
+   * callers so their fast path stays small.
+   */
+  [[noreturn]] inline void throwNullMaybe() {
+#if MAYBE_EXCEPTIONS
+      throw null_maybe_exception();
+#else
+      std::abort();
+#endif
+  }
+
+  /*!
+   * a == b, or false if the two types cannot be compared
+   */
+  template<typename T, typename oT>
+  constexpr bool doEqualComparison(const T& a, const oT& b) {
+      if constexpr (Maybe_Tests::EqualExists<T, oT>::value) {
+          return a == b;
+      } else {
+          (void)a;
+          (void)b;
+          return false;
+      }
+  }
+
+  /*!
+   * The payload type a Maybe of T counts as when checking whether two
+   * empty Maybes are of the same type. A Maybe<const T&> counts as a
+   * Maybe<T>.
+   */
+  template <typename T>
+  struct ComparedAs {
+      typedef T type;
+  };
+
+  template <typename T>
+  struct ComparedAs<T&> {
+      typedef typename std::remove_cv<T>::type type;
+  };
+
+  /*!
+   * The truth table from Maybe::operator==, applied to anything which
+   * tests and dereferences like a Maybe of T and oT. Shared with the
+   * containers that hand out Maybe-like references.
+   */
+  template<typename T, typename oT, typename A, typename B>
+  constexpr bool equalMaybes(const A& a, const B& b) {
+      if ((a && !b) || (!a && b)) {
+          return false;
+      }
+
+      if (!a && !b) {
+          return std::is_same<typename ComparedAs<T>::type, typename ComparedAs<oT>::type>::value;
+      }
+
+      return doEqualComparison<T, oT>(*a, *b);
+  }
+}
+
+/*!
+ * Storage policy which keeps the value inside the Maybe itself, next
+ * to a flag saying whether there is one. This is the default, and
+ * never touches an allocator.
+ */
+struct MaybeInline {};
+
+/*!
+ * Storage policy which keeps the value on the heap, so the Maybe only
+ * holds a pointer to it. Useful for very large types, or for types
+ * which are still incomplete where the Maybe is declared.
+ *
+ * Memory comes from Alloc (rebound to the value type), which is used
+ * through std::allocator_traits and takes no space in the Maybe when
+ * it is stateless.
+ */
+template <typename Alloc = std::allocator<void> >
+struct MaybeBoxed {};
+
+/*!
+ * Lets a type declare a spare "empty" value, so that an inline Maybe of
+ * it can use that value instead of a separate engaged flag and be
+ * exactly as big as the type itself. A specialization sets value to
+ * true and provides:
+ *
+ *     static T empty();                //the sentinel
+ *     static bool is_empty(const T&);  //whether a T holds the sentinel
+ *
+ * A T which ends up holding the sentinel is treated as no value at
+ * all, so for example a Maybe<int*> holding a null pointer is empty.
+ *
+ * Raw pointers and std::unique_ptr are covered out of the box.
+ * std::reference_wrapper is not, since it has no null state that can be
+ * made without undefined behaviour.
+ */
+template <typename T>
+struct maybe_niche {
+    static constexpr bool value = false;
+};
+
+template <typename T>
+struct maybe_niche<T*> {
+    static constexpr bool value = true;
+    static constexpr T* empty() noexcept { return nullptr; }
+    static constexpr bool is_empty(T* const& p) noexcept { return p == nullptr; }
+};
+
+template <typename T, typename D>
+struct maybe_niche<std::unique_ptr<T, D> > {
+    static constexpr bool value = true;
+    static std::unique_ptr<T, D> empty() noexcept { return std::unique_ptr<T, D>(); }
+    static bool is_empty(const std::unique_ptr<T, D>& p) noexcept { return p == nullptr; }
+};
+
+template <typename T, typename Policy = MaybeInline>
+class Maybe;
+
+namespace Maybe_Detail
+{
+  template <typename T, typename Policy, bool Niche = maybe_niche<T>::value>
+  class Storage;
+
+  template <typename M>
+  struct IsMaybe : std::false_type {};
+
+  template <typename T, typename Policy>
+  struct IsMaybe<Maybe<T, Policy> > : std::true_type {};
+
+  /*!
+   * True for the Maybe-like references handed out by containers such as
+   * MaybeVector. They mark themselves with a maybe_proxy_of typedef and
+   * convert to a Maybe, which is how they are copied into one.
+   */
+  template <typename A, typename = void>
+  struct IsMaybeProxy : std::false_type {};
+
+  template <typename A>
+  struct IsMaybeProxy<A, std::void_t<typename A::maybe_proxy_of> > : std::true_type {};
+
+  /*!
+   * How many Maybes deep M is: 0 for anything which is not a Maybe, 1
+   * for a Maybe<int>, 2 for a Maybe<Maybe<int>> and so on.
+   */
+  template <typename M>
+  struct MaybeDepth : std::integral_constant<int, 0> {};
+
+  template <typename T, typename Policy>
+  struct MaybeDepth<Maybe<T, Policy> > : std::integral_constant<int,
+      1 + MaybeDepth<typename std::remove_cv<typename std::remove_reference<T>::type>::type>::value> {};
+
+  /*!
+   * True when a single argument of type A should go to one of Maybe's
+   * own constructors or assignment operators (copy/move, a conversion
+   * from another Maybe, a proxy, nullptr or in_place) rather than be
+   * forwarded to T.
+   *
+   * A Maybe at least as deep as M is always taken by M itself, since
+   * forwarding it to T would only find T's conversion from bool. Only a
+   * shallower one, such as the Maybe<int> given to a Maybe<Maybe<int>>,
+   * is forwarded to be wrapped.
+   */
+  template <typename M, typename... A>
+  struct IsReservedArg : std::false_type {};
+
+  template <typename M, typename A>
+  struct IsReservedArg<M, A> : std::integral_constant<bool,
+      std::is_same<typename std::decay<A>::type, M>::value ||
+      (IsMaybe<typename std::decay<A>::type>::value &&
+       MaybeDepth<typename std::decay<A>::type>::value >= MaybeDepth<M>::value) ||
+      IsMaybeProxy<typename std::decay<A>::type>::value ||
+      std::is_same<typename std::decay<A>::type, std::nullptr_t>::value ||
+      std::is_same<typename std::decay<A>::type, std::in_place_t>::value> {};
+
+  /*!
+   * True when a Maybe<T, Policy> can be made from an O, another Maybe of
+   * the same depth, value by value: T is built from Arg, which is what
+   * dereferencing the O gives.
+   */
+  template <typename T, typename Policy, typename O, typename Arg>
+  struct IsMaybeConversion : std::integral_constant<bool,
+      IsMaybe<O>::value && !std::is_same<O, Maybe<T, Policy> >::value &&
+      MaybeDepth<O>::value == MaybeDepth<Maybe<T, Policy> >::value &&
+      std::is_constructible<T, Arg>::value> {};
+
+  /*!
+   * Plain numbers and enums. An empty inline Maybe of one still holds a
+   * zeroed value, so it can always be read, which is what lets
+   * operator== compare them without branching.
+   */
+  template <typename T>
+  struct IsPlain : std::integral_constant<bool, std::is_arithmetic<T>::value || std::is_enum<T>::value> {};
+
+  /*!
+   * True when a Maybe<T, Policy> and a Maybe<oT, oPolicy> can be
+   * compared without branches: both are inline, not niche, and hold
+   * plain values which compare with ==.
+   */
+  template <typename T, typename Policy, typename oT, typename oPolicy>
+  struct BranchFreeEqual : std::integral_constant<bool,
+      std::is_same<Policy, MaybeInline>::value && std::is_same<oPolicy, MaybeInline>::value &&
+      !maybe_niche<T>::value && !maybe_niche<oT>::value &&
+      IsPlain<T>::value && IsPlain<oT>::value && Maybe_Tests::EqualExists<T, oT>::value> {};
+
+  /*!
+   * The raw members of inline storage: the value in a union next to an
+   * engaged flag. The union is only ever active while engaged is true.
+   * The destructor is left trivial when T's is.
+   */
+  template <typename T, bool = std::is_trivially_destructible<T>::value>
+  struct InlineData {
+      union {
+          char empty;
+          T value;
+      };
+      bool engaged;
+
+      constexpr InlineData() : empty(), engaged(false) {}
+
+      template <typename... Args>
+      constexpr explicit InlineData(std::in_place_t, Args&&... args)
+          : value(std::forward<Args>(args)...), engaged(true) {}
+
+      ~InlineData() {
+          if (engaged) {
+              value.~T();
+          }
+      }
+  };
+
+  template <typename T>
+  struct InlineData<T, true> {
+      union {
+          char empty;
+          T value;
+      };
+      bool engaged;
+
+      constexpr InlineData() : InlineData(IsPlain<T>()) {}
+
+      constexpr explicit InlineData(std::true_type) : value(), engaged(false) {}
+      constexpr explicit InlineData(std::false_type) : empty(), engaged(false) {}
+
+      template <typename... Args>
+      constexpr explicit InlineData(std::in_place_t, Args&&... args)
+          : value(std::forward<Args>(args)...), engaged(true) {}
+  };
+
+  /*!
+   * Everything inline storage does, apart from the special members.
+   */
+  template <typename T>
+  struct InlineOps : InlineData<T> {
+
+      using InlineData<T>::InlineData;
+      using InlineData<T>::value;
+      using InlineData<T>::engaged;
+
+      constexpr bool has_value() const {
+          return engaged;
+      }
+
+      constexpr T* get() {
+          return std::addressof(value);
+      }
+
+      constexpr const T* get() const {
+          return std::addressof(value);
+      }
+
+      /*!
+       * Builds a value in place. The storage must be empty.
+       */
+      template <typename... Args>
+      void construct(Args&&... args) {
+          ::new (static_cast<void*>(std::addressof(value))) T(std::forward<Args>(args)...);
+          engaged = true;
+      }
+
+      /*!
+       * Trivially destructible values are left where they are, so
+       * plain ones stay readable.
+       */
+      void reset() {
+          if (engaged) {
+              if (!std::is_trivially_destructible<T>::value) {
+                  value.~T();
+              }
+              engaged = false;
+          }
+      }
+
+      /*!
+       * The value, whether or not there is one. Only for plain T.
+       */
+      constexpr const T& raw() const {
+          return value;
+      }
+
+      static constexpr bool nothrowMove = std::is_nothrow_move_constructible<T>::value;
+      static constexpr bool nothrowMoveAssign =
+          std::is_nothrow_move_constructible<T>::value && std::is_nothrow_move_assignable<T>::value;
+
+      /*!
+       * Copies or moves other's value, if it has one, into storage which
+       * is still empty
+       */
+      void constructFrom(const InlineOps& other) {
+          MAYBE_RECORD(T, MaybeInline, Copies, 1);
+          if (other.engaged) {
+              construct(other.value);
+          }
+      }
+
+      void constructFrom(InlineOps&& other) {
+          MAYBE_RECORD(T, MaybeInline, Moves, 1);
+          if (other.engaged) {
+              construct(std::move(other.value));
+          }
+      }
+
+      /*!
+       * Assigns onto the existing value when both sides are engaged, so
+       * T keeps any resources it already owns.
+       */
+      template <typename Other>
+      void assign(Other&& other) {
+          if (engaged && other.engaged) {
+              value = std::forward<Other>(other).value;
+          } else if (other.engaged) {
+              construct(std::forward<Other>(other).value);
+          } else {
+              reset();
+          }
+      }
+
+      void swap(InlineOps& other) noexcept(
+          std::is_nothrow_move_constructible<T>::value && std::is_nothrow_swappable<T>::value) {
+          if (engaged && other.engaged) {
+              using std::swap;
+              swap(value, other.value);
+          } else if (engaged) {
+              other.construct(std::move(value));
+              reset();
+          } else if (other.engaged) {
+              construct(std::move(other.value));
+              other.reset();
+          }
+      }
+  };
+
+  /*!
+   * The layers below each supply one special member on top of a Base
+   * which does the real work, and leave it defaulted (and so trivial)
+   * when Trivial is true. This is what makes Maybe<int> trivially
+   * copyable. Base must be default constructible into a blank state
+   * with nothing to destroy, and provide:
+   *
+   *     void constructFrom(const Base&);  //copy into a blank Base
+   *     void constructFrom(Base&&);       //move into a blank Base
+   *     void assign(const Base&);
+   *     void assign(Base&&);
+   *     static constexpr bool nothrowMove;        //for the move constructor
+   *     static constexpr bool nothrowMoveAssign;  //for move assignment
+   */
+  template <typename Base, bool Trivial>
+  struct CopyConstructLayer : Base {
+      using Base::Base;
+  };
+
+  template <typename Base>
+  struct CopyConstructLayer<Base, false> : Base {
+      using Base::Base;
+
+      CopyConstructLayer() = default;
+      CopyConstructLayer(const CopyConstructLayer& other) : Base() {
+          this->constructFrom(static_cast<const Base&>(other));
+      }
+      CopyConstructLayer(CopyConstructLayer&&) = default;
+      CopyConstructLayer& operator=(const CopyConstructLayer&) = default;
+      CopyConstructLayer& operator=(CopyConstructLayer&&) = default;
+  };
+
+  template <typename Base, bool Trivial>
+  struct MoveConstructLayer : Base {
+      using Base::Base;
+  };
+
+  template <typename Base>
+  struct MoveConstructLayer<Base, false> : Base {
+      using Base::Base;
+
+      MoveConstructLayer() = default;
+      MoveConstructLayer(const MoveConstructLayer&) = default;
+      MoveConstructLayer(MoveConstructLayer&& other) noexcept(Base::nothrowMove) : Base() {
+          this->constructFrom(static_cast<Base&&>(other));
+      }
+      MoveConstructLayer& operator=(const MoveConstructLayer&) = default;
+      MoveConstructLayer& operator=(MoveConstructLayer&&) = default;
+  };
+
+  template <typename Base, bool Trivial>
+  struct CopyAssignLayer : Base {
+      using Base::Base;
+  };
+
+  template <typename Base>
+  struct CopyAssignLayer<Base, false> : Base {
+      using Base::Base;
+
+      CopyAssignLayer() = default;
+      CopyAssignLayer(const CopyAssignLayer&) = default;
+      CopyAssignLayer(CopyAssignLayer&&) = default;
+      CopyAssignLayer& operator=(const CopyAssignLayer& other) {
+          this->assign(static_cast<const Base&>(other));
+          return *this;
+      }
+      CopyAssignLayer& operator=(CopyAssignLayer&&) = default;
+  };
+
+  template <typename Base, bool Trivial>
+  struct MoveAssignLayer : Base {
+      using Base::Base;
+  };
+
+  template <typename Base>
+  struct MoveAssignLayer<Base, false> : Base {
+      using Base::Base;
+
+      MoveAssignLayer() = default;
+      MoveAssignLayer(const MoveAssignLayer&) = default;
+      MoveAssignLayer(MoveAssignLayer&&) = default;
+      MoveAssignLayer& operator=(const MoveAssignLayer&) = default;
+      MoveAssignLayer& operator=(MoveAssignLayer&& other) noexcept(Base::nothrowMoveAssign) {
+          this->assign(static_cast<Base&&>(other));
+          return *this;
+      }
+  };
+
+  /*!
+   * Stacks all four layers on Base. Each Trivial flag is whether T (and
+   * anything else Base holds) makes that member trivial.
+   */
+  template <typename Base, bool CopyConstruct, bool MoveConstruct, bool CopyAssign, bool MoveAssign>
+  using SpecialMembers = MoveAssignLayer<CopyAssignLayer<MoveConstructLayer<CopyConstructLayer<
+      Base, CopyConstruct>, MoveConstruct>, CopyAssign>, MoveAssign>;
+
+  template <typename T>
+  using InlineStorage = SpecialMembers<InlineOps<T>,
+      std::is_trivially_copy_constructible<T>::value,
+      std::is_trivially_move_constructible<T>::value,
+      std::is_trivially_copy_constructible<T>::value && std::is_trivially_copy_assignable<T>::value &&
+          std::is_trivially_destructible<T>::value,
+      std::is_trivially_move_constructible<T>::value && std::is_trivially_move_assignable<T>::value &&
+          std::is_trivially_destructible<T>::value>;
+
+  /*!
+   * Deletes whichever special members T cannot support, so the traits
+   * report the truth about Maybe<T> instead of failing on use.
+   */
+  template <bool>
+  struct EnableCopyConstruct {};
+
+  template <>
+  struct EnableCopyConstruct<false> {
+      EnableCopyConstruct() = default;
+      EnableCopyConstruct(const EnableCopyConstruct&) = delete;
+      EnableCopyConstruct(EnableCopyConstruct&&) = default;
+      EnableCopyConstruct& operator=(const EnableCopyConstruct&) = default;
+      EnableCopyConstruct& operator=(EnableCopyConstruct&&) = default;
+  };
+
+  template <bool>
+  struct EnableMoveConstruct {};
+
+  template <>
+  struct EnableMoveConstruct<false> {
+      EnableMoveConstruct() = default;
+      EnableMoveConstruct(const EnableMoveConstruct&) = default;
+      EnableMoveConstruct(EnableMoveConstruct&&) = delete;
+      EnableMoveConstruct& operator=(const EnableMoveConstruct&) = default;
+      EnableMoveConstruct& operator=(EnableMoveConstruct&&) = default;
+  };
+
+  template <bool>
+  struct EnableCopyAssign {};
+
+  template <>
+  struct EnableCopyAssign<false> {
+      EnableCopyAssign() = default;
+      EnableCopyAssign(const EnableCopyAssign&) = default;
+      EnableCopyAssign(EnableCopyAssign&&) = default;
+      EnableCopyAssign& operator=(const EnableCopyAssign&) = delete;
+      EnableCopyAssign& operator=(EnableCopyAssign&&) = default;
+  };
+
+  template <bool>
+  struct EnableMoveAssign {};
+
+  template <>
+  struct EnableMoveAssign<false> {
+      EnableMoveAssign() = default;
+      EnableMoveAssign(const EnableMoveAssign&) = default;
+      EnableMoveAssign(EnableMoveAssign&&) = default;
+      EnableMoveAssign& operator=(const EnableMoveAssign&) = default;
+      EnableMoveAssign& operator=(EnableMoveAssign&&) = delete;
+  };
+
+  /*!
+   * Keeps the value inside the Maybe.
+   */
+  template <typename T>
+  class Storage<T, MaybeInline, false>
+      : public InlineStorage<T>,
+        private EnableCopyConstruct<std::is_copy_constructible<T>::value>,
+        private EnableMoveConstruct<std::is_move_constructible<T>::value>,
+        private EnableCopyAssign<std::is_copy_constructible<T>::value && std::is_copy_assignable<T>::value>,
+        private EnableMoveAssign<std::is_move_constructible<T>::value && std::is_move_assignable<T>::value> {
+  public:
+      using InlineStorage<T>::InlineStorage;
+
+      void swap(Storage& other) noexcept(noexcept(std::declval<InlineOps<T>&>().swap(other))) {
+          InlineOps<T>::swap(other);
+      }
+  };
+
+  /*!
+   * Keeps nothing but the value itself, using the sentinel from
+   * maybe_niche<T> to mean empty.
+   */
+  template <typename T>
+  class Storage<T, MaybeInline, true> {
+
+      typedef maybe_niche<T> Niche;
+
+      T value;
+
+  public:
+      constexpr Storage() : value(Niche::empty()) {}
+
+      template <typename... Args>
+      constexpr explicit Storage(std::in_place_t, Args&&... args) : value(std::forward<Args>(args)...) {}
+
+      void swap(Storage& other) noexcept(std::is_nothrow_swappable<T>::value) {
+          using std::swap;
+          swap(value, other.value);
+      }
+
+      constexpr bool has_value() const {
+          return !Niche::is_empty(value);
+      }
+
+      constexpr T* get() {
+          return std::addressof(value);
+      }
+
+      constexpr const T* get() const {
+          return std::addressof(value);
+      }
+
+      /*!
+       * Replaces the sentinel with a real value. The storage must be
+       * empty.
+       */
+      template <typename... Args>
+      void construct(Args&&... args) {
+          value = T(std::forward<Args>(args)...);
+      }
+
+      void reset() {
+          value = Niche::empty();
+      }
+  };
+
+  /*!
+   * Turns a possibly fancy allocator pointer into a raw one.
+   */
+  template <typename T>
+  T* ToAddress(T* p) {
+      return p;
+  }
+
+  template <typename P>
+  auto ToAddress(const P& p) -> decltype(ToAddress(p.operator->())) {
+      return ToAddress(p.operator->());
+  }
+
+#if MAYBE_DEBUG_CHECKS
+  /*!
+   * Prints what went wrong, with the stack where the Maybe was last
+   * emptied if there is one and the stack of the bad access, and stops.
+   */
+  [[noreturn]] inline void reportBadAccess(const char* what, void* const* emptiedAt, int depth) {
+      std::fprintf(stderr, "Maybe: %s\n", what);
+#if MAYBE_BACKTRACE
+      if (depth > 0) {
+          std::fprintf(stderr, "last emptied at:\n");
+          backtrace_symbols_fd(const_cast<void**>(emptiedAt), depth, 2);
+      }
+      void* here[32];
+      std::fprintf(stderr, "accessed at:\n");
+      backtrace_symbols_fd(here, backtrace(here, 32), 2);
+#else
+      (void)emptiedAt;
+      (void)depth;
+#endif
+      std::abort();
+  }
+
+  /*!
+   * What a boxed Maybe with MAYBE_DEBUG_CHECKS knows about itself, kept
+   * apart from its pointer: whether it is alive, whether it holds a
+   * value, and the stack from the last time it was emptied. It belongs to
+   * one object, so copying a Maybe does not copy it.
+   */
+  class DebugState {
+
+      enum : unsigned { Alive = 0x4d617962u, Dead = 0xdeadbeefu };
+
+      unsigned tag;
+      bool engaged;
+      int depth;
+      void* emptiedAt[16];
+
+  public:
+      DebugState() : tag(Alive), engaged(false), depth(0) {}
+
+      DebugState(const DebugState&) : DebugState() {}
+
+      DebugState& operator=(const DebugState&) {
+          return *this;
+      }
+
+      /*!
+       * Marks the object dead, with a store the compiler won't drop just
+       * because nothing should read it afterwards
+       */
+      ~DebugState() {
+          *static_cast<volatile unsigned*>(&tag) = Dead;
+      }
+
+      /*!
+       * Records whether the Maybe now holds a value, capturing the stack
+       * if it just lost it
+       */
+      void track(bool hasValue) {
+          if (engaged && !hasValue) {
+#if MAYBE_BACKTRACE
+              depth = backtrace(emptiedAt, 16);
+#endif
+          }
+          engaged = hasValue;
+      }
+
+      void checkAlive() const {
+          if (*static_cast<const volatile unsigned*>(&tag) != Alive) {
+              reportBadAccess("access to a Maybe which has been destroyed", emptiedAt, 0);
+          }
+      }
+
+      /*!
+       * Checks that the value may be read: the Maybe is alive, holds a
+       * value, and its pointer agrees
+       */
+      void checkAccess(bool hasValue) const {
+          checkAlive();
+          if (!engaged) {
+              reportBadAccess("access to the value of an empty Maybe", emptiedAt, depth);
+          }
+          if (!hasValue) {
+              reportBadAccess("Maybe storage is corrupt: it has a value but no pointer to it", emptiedAt, depth);
+          }
+      }
+  };
+#endif
+
+  /*!
+   * Holds an allocator, using the empty base optimisation so that a
+   * stateless one adds nothing to the size of its owner.
+   */
+  template <typename Alloc, bool = std::is_empty<Alloc>::value && !std::is_final<Alloc>::value>
+  class AllocHolder : private Alloc {
+  public:
+      AllocHolder() = default;
+      explicit AllocHolder(const Alloc& a) : Alloc(a) {}
+      explicit AllocHolder(Alloc&& a) : Alloc(std::move(a)) {}
+
+      Alloc& allocator() { return *this; }
+      const Alloc& allocator() const { return *this; }
+  };
+
+  template <typename Alloc>
+  class AllocHolder<Alloc, false> {
+      Alloc alloc;
+  public:
+      AllocHolder() = default;
+      explicit AllocHolder(const Alloc& a) : alloc(a) {}
+      explicit AllocHolder(Alloc&& a) : alloc(std::move(a)) {}
+
+      Alloc& allocator() { return alloc; }
+      const Alloc& allocator() const { return alloc; }
+  };
+
+  /*!
+   * Keeps the value on the heap, with a null pointer meaning empty.
+   * Allocator propagation on copy, move and swap follows
+   * std::allocator_traits the same way the standard containers do.
+   */
+  template <typename T, typename A>
+  class BoxedStorage
+      : private AllocHolder<typename std::allocator_traits<A>::template rebind_alloc<T> > {
+
+      typedef typename std::allocator_traits<A>::template rebind_alloc<T> Alloc;
+      typedef std::allocator_traits<Alloc> Traits;
+      typedef AllocHolder<Alloc> Holder;
+      typedef typename Traits::pointer pointer;
+
+      pointer value;
+#if MAYBE_DEBUG_CHECKS
+      DebugState debug;
+#endif
+
+      using Holder::allocator;
+
+      /*!
+       * Tells the debug state whether there is a value now
+       */
+      void track() {
+#if MAYBE_DEBUG_CHECKS
+          debug.track(value != nullptr);
+#endif
+      }
+
+  public:
+      BoxedStorage() : value(nullptr) {}
+
+      template <typename... Args>
+      explicit BoxedStorage(std::in_place_t, Args&&... args) : value(nullptr) {
+          construct(std::forward<Args>(args)...);
+      }
+
+      explicit BoxedStorage(std::allocator_arg_t, const Alloc& a) : Holder(a), value(nullptr) {}
+
+      BoxedStorage(const BoxedStorage& other)
+          : Holder(Traits::select_on_container_copy_construction(other.allocator())), value(nullptr) {
+          MAYBE_RECORD(T, MaybeBoxed<A>, Copies, 1);
+          if (other.value != nullptr) {
+              construct(*other.value);
+          }
+      }
+
+      BoxedStorage(BoxedStorage&& other) noexcept : Holder(std::move(other.allocator())), value(other.value) {
+          MAYBE_RECORD(T, MaybeBoxed<A>, Moves, 1);
+          other.value = nullptr;
+          track();
+          other.track();
+      }
+
+      ~BoxedStorage() {
+          reset();
+      }
+
+      /*!
+       * Assigns onto the existing value when both sides are engaged
+       * instead of freeing it and allocating a new one.
+       */
+      BoxedStorage& operator=(const BoxedStorage& other) {
+          if (this == &other) {
+              return *this;
+          }
+
+          if constexpr (Traits::propagate_on_container_copy_assignment::value) {
+              if (!Traits::is_always_equal::value && allocator() != other.allocator()) {
+                  reset();
+              }
+              allocator() = other.allocator();
+          }
+
+          if (value != nullptr && other.value != nullptr) {
+              *value = *other.value;
+          } else if (other.value != nullptr) {
+              construct(*other.value);
+          } else {
+              reset();
+          }
+          return *this;
+      }
+
+      /*!
+       * Steals other's pointer, which is cheaper than assigning T. If
+       * the allocators differ and do not propagate, the value is moved
+       * across instead and other keeps a moved-from value.
+       */
+      BoxedStorage& operator=(BoxedStorage&& other) noexcept(
+          Traits::propagate_on_container_move_assignment::value || Traits::is_always_equal::value) {
+          if (this == &other) {
+              return *this;
+          }
+
+          if constexpr (Traits::propagate_on_container_move_assignment::value) {
+              reset();
+              allocator() = std::move(other.allocator());
+          } else if constexpr (!Traits::is_always_equal::value) {
+              if (allocator() != other.allocator()) {
+                  if (value != nullptr && other.value != nullptr) {
+                      *value = std::move(*other.value);
+                  } else if (other.value != nullptr) {
+                      construct(std::move(*other.value));
+                  } else {
+                      reset();
+                  }
+                  return *this;
+              }
+          }
+
+          reset();
+          value = other.value;
+          other.value = nullptr;
+          track();
+          other.track();
+          return *this;
+      }
+
+      /*!
+       * Swaps the pointers when the allocators allow it, and the values
+       * otherwise.
+       */
+      void swap(BoxedStorage& other) noexcept(
+          Traits::propagate_on_container_swap::value || Traits::is_always_equal::value) {
+          using std::swap;
+
+          if constexpr (Traits::propagate_on_container_swap::value) {
+              swap(allocator(), other.allocator());
+          } else if constexpr (!Traits::is_always_equal::value) {
+              if (allocator() != other.allocator()) {
+                  if (value != nullptr && other.value != nullptr) {
+                      swap(*value, *other.value);
+                  } else if (value != nullptr) {
+                      other.construct(std::move(*value));
+                      reset();
+                  } else if (other.value != nullptr) {
+                      construct(std::move(*other.value));
+                      other.reset();
+                  }
+                  return;
+              }
+          }
+
+          swap(value, other.value);
+          track();
+          other.track();
+      }
+
+      bool has_value() const {
+#if MAYBE_DEBUG_CHECKS
+          debug.checkAlive();
+#endif
+          return value != nullptr;
+      }
+
+      T* get() {
+#if MAYBE_DEBUG_CHECKS
+          debug.checkAccess(value != nullptr);
+#endif
+          return ToAddress(value);
+      }
+
+      const T* get() const {
+#if MAYBE_DEBUG_CHECKS
+          debug.checkAccess(value != nullptr);
+#endif
+          return ToAddress(value);
+      }
+
+      /*!
+       * Builds a value on the heap. The storage must be empty.
+       */
+      template <typename... Args>
+      void construct(Args&&... args) {
+          pointer p = Traits::allocate(allocator(), 1);
+#if MAYBE_EXCEPTIONS
+          try {
+              Traits::construct(allocator(), ToAddress(p), std::forward<Args>(args)...);
+          } catch (...) {
+              Traits::deallocate(allocator(), p, 1);
+              throw;
+          }
+#else
+          Traits::construct(allocator(), ToAddress(p), std::forward<Args>(args)...);
+#endif
+          value = p;
+          track();
+          MAYBE_RECORD(T, MaybeBoxed<A>, Allocations, 1);
+          MAYBE_RECORD(T, MaybeBoxed<A>, BytesAllocated, sizeof(T));
+      }
+
+      /*!
+       * Destroys the value and hands its memory back to the allocator.
+       */
+      void reset() {
+          if (value != nullptr) {
+              Traits::destroy(allocator(), ToAddress(value));
+              Traits::deallocate(allocator(), value, 1);
+              value = nullptr;
+              track();
+              MAYBE_RECORD(T, MaybeBoxed<A>, Deallocations, 1);
+              MAYBE_RECORD(T, MaybeBoxed<A>, BytesFreed, sizeof(T));
+          }
+      }
+  };
+  /*!
+   * True when moving boxed storage onto another only ever hands the
+   * pointer over, so T itself need not be movable
+   */
+  template <typename A>
+  struct BoxedMovesPointer : std::integral_constant<bool,
+      std::allocator_traits<A>::propagate_on_container_move_assignment::value ||
+      std::allocator_traits<A>::is_always_equal::value> {};
+
+  /*!
+   * Boxed storage, with the members deleted which T can't support, as
+   * they are for inline storage. Move construction only takes the
+   * pointer, so it is there whatever T is.
+   */
+  template <typename T, typename A, bool Niche>
+  class Storage<T, MaybeBoxed<A>, Niche>
+      : public BoxedStorage<T, A>,
+        private EnableCopyConstruct<std::is_copy_constructible<T>::value>,
+        private EnableCopyAssign<std::is_copy_constructible<T>::value && std::is_copy_assignable<T>::value>,
+        private EnableMoveAssign<BoxedMovesPointer<A>::value ||
+                                 (std::is_move_constructible<T>::value && std::is_move_assignable<T>::value)> {
+  public:
+      using BoxedStorage<T, A>::BoxedStorage;
+  };
+}
+
 /*!
  * This class is based off of the class of the same name in Haskell.
- * It represents a value that may or may not exist. A Maybe of any
- * given type holds a pointer to a value, which will either point
- * to actual data or to nothing. Care should be taken to ensure
- * that the Maybe actually stores a value before trying to use it.
+ * It represents a value that may or may not exist. By default the
+ * value is stored inside the Maybe itself (see MaybeInline); passing
+ * MaybeBoxed<Alloc> as the second template argument keeps it on the
+ * heap instead. Types with a spare value (see maybe_niche) are stored
+ * with no extra state at all. Care should be taken to ensure that the
+ * Maybe actually stores a value before trying to use it.
+ *
+ * An inline Maybe of a literal type can be built, tested, read and
+ * compared in constant expressions, so tables of them can be laid out
+ * at compile time.
  *
  * Example usage:
  *
@@ -66,96 +1117,156 @@ public:
  *     if(maybeWithoutValue) {
  *         //It will now make it in here, since it now has a value
  *     }
+ *
+ *     //a large value can be kept on the heap instead
+ *     Maybe<BigTable, MaybeBoxed<> > boxed(table);
+ *
+ *     //or in memory from a particular allocator
+ *     Maybe<BigTable, MaybeBoxed<ArenaAlloc> > fromArena(std::allocator_arg, arenaAlloc, table);
  */
-template <typename T>
+template <typename T, typename Policy>
 class Maybe {
 
-    T* value;
-    std::allocator<T> alloc;
+    template <typename, typename>
+    friend class Maybe;
+
+    Maybe_Detail::Storage<T, Policy> storage;
 
 public:
     /*!
      * Constructs a non-empty Maybe by forwarding the args to the
-     * templated type's constructor.
+     * templated type's constructor. Rvalues are moved, not copied.
      */
-    template <typename... Ts>
-    Maybe<T>(const Ts&... args) {
-        value = alloc.allocate(1);
-        alloc.construct(value, args...);
+    template <typename... Ts, typename = typename std::enable_if<
+        !Maybe_Detail::IsReservedArg<Maybe, Ts...>::value &&
+        std::is_constructible<T, Ts&&...>::value>::type>
+    constexpr Maybe(Ts&&... args) : storage(std::in_place, std::forward<Ts>(args)...) {
+        MAYBE_RECORD(T, Policy, Constructions, 1);
     }
 
     /*!
-     * Constructs an empty maybe
+     * Constructs a non-empty Maybe by building T directly in the
+     * Maybe's storage. Unlike the constructor above this can also take
+     * a single argument that would otherwise be taken by Maybe itself,
+     * e.g. `Maybe<Maybe<int>> m(std::in_place, nullptr)`.
      */
-    Maybe<T>() {
-        value = nullptr;
+    template <typename... Ts>
+    constexpr explicit Maybe(std::in_place_t, Ts&&... args) : storage(std::in_place, std::forward<Ts>(args)...) {
+        MAYBE_RECORD(T, Policy, Constructions, 1);
     }
 
     /*!
-     * Construct with null pointer
+     * Constructs an empty Maybe whose boxed storage will come from
+     * alloc. Only available with MaybeBoxed.
      */
-    Maybe<T>(const std::nullptr_t& null_p) {
-        value = null_p;
-    }
+    template <typename A>
+    Maybe(std::allocator_arg_t, const A& alloc) : storage(std::allocator_arg, alloc) {}
 
     /*!
-     * Frees up the contained value, if there is one
+     * Constructs a non-empty Maybe whose boxed storage comes from alloc,
+     * forwarding the args to the templated type's constructor. Only
+     * available with MaybeBoxed.
      */
-    ~Maybe<T>() {
-        if (value != nullptr) {
-            alloc.destroy(value);
-        }
+    template <typename A, typename... Ts, typename = typename std::enable_if<
+        (sizeof...(Ts) > 0) && std::is_constructible<T, Ts&&...>::value>::type>
+    Maybe(std::allocator_arg_t, const A& alloc, Ts&&... args) : storage(std::allocator_arg, alloc) {
+        storage.construct(std::forward<Ts>(args)...);
+        MAYBE_RECORD(T, Policy, Constructions, 1);
     }
 
+    /*!
+     * Constructs an empty maybe
+     */
+    constexpr Maybe() {}
+
+    /*!
+     * Construct with null pointer
+     */
+    constexpr Maybe(const std::nullptr_t&) {}
+
     /*!
      * Copy constructor
      */
-    Maybe<T>(const Maybe<T>& other) {
-        if (other.value != nullptr) {
-            value = alloc.allocate(1);
-            alloc.construct(value, *other);
-        } else {
-            value = nullptr;
-        }
-    }
+    Maybe(const Maybe& other) = default;
 
     /*!
      * Move constructor
+     *
+     * With MaybeBoxed the pointer is stolen and other is left empty.
+     * With MaybeInline the value is moved, so other keeps whatever
+     * T's move constructor left behind.
+     *
+     * Moves are noexcept whenever the matching operations on T are (and
+     * always for boxed storage, unless a move assignment has to move the
+     * value between two unequal allocators), so std::vector moves
+     * rather than copies Maybes when it grows.
      */
-    Maybe<T>(Maybe<T>&& other) {
-        value = other.value;
-        other.value = nullptr;
-    }
+    Maybe(Maybe&& other) = default;
 
     /*!
-     * Copy assignment operator
+     * Converts from a Maybe of another type or storage policy, building
+     * T from its value if it has one. Explicit when that value does not
+     * implicitly convert to T.
+     *
+     *     Maybe<int, MaybeBoxed<> > boxed(5);
+     *     Maybe<long> widened = boxed;    //holds 5
      */
-    Maybe<T>& operator=(const Maybe<T>& other) {
-        if (value != nullptr) {
-            alloc.destroy(value);
-        }
+    template <typename U, typename oPolicy, typename std::enable_if<
+        Maybe_Detail::IsMaybeConversion<T, Policy, Maybe<U, oPolicy>, const U&>::value &&
+        std::is_convertible<const U&, T>::value, int>::type = 0>
+    Maybe(const Maybe<U, oPolicy>& other) {
+        constructFrom(other);
+    }
 
-        if (other.value != nullptr) {
-            value = alloc.allocate(1);
-            alloc.construct(value, *other);
-        } else {
-            value = nullptr;
-        }
+    template <typename U, typename oPolicy, typename std::enable_if<
+        Maybe_Detail::IsMaybeConversion<T, Policy, Maybe<U, oPolicy>, const U&>::value &&
+        !std::is_convertible<const U&, T>::value, int>::type = 0>
+    explicit Maybe(const Maybe<U, oPolicy>& other) {
+        constructFrom(other);
+    }
 
-        return *this;
+    template <typename U, typename oPolicy, typename std::enable_if<
+        Maybe_Detail::IsMaybeConversion<T, Policy, Maybe<U, oPolicy>, U&&>::value &&
+        std::is_convertible<U&&, T>::value, int>::type = 0>
+    Maybe(Maybe<U, oPolicy>&& other) {
+        constructFrom(std::move(other));
+    }
+
+    template <typename U, typename oPolicy, typename std::enable_if<
+        Maybe_Detail::IsMaybeConversion<T, Policy, Maybe<U, oPolicy>, U&&>::value &&
+        !std::is_convertible<U&&, T>::value, int>::type = 0>
+    explicit Maybe(Maybe<U, oPolicy>&& other) {
+        constructFrom(std::move(other));
     }
 
+    /*!
+     * Copy assignment operator
+     */
+    Maybe& operator=(const Maybe& other) = default;
+
     /*!
      * Move assignment operator
      */
-    Maybe<T>& operator=(Maybe<T>&& other) {
-        if (value != nullptr){
-            alloc.destroy(value);
-        }
+    Maybe& operator=(Maybe&& other) = default;
 
-        value = other.value;
-        other.value = nullptr;
+    /*!
+     * Assigns from a Maybe of another type or storage policy: empties
+     * this one if other is empty, and otherwise assigns or builds T from
+     * other's value.
+     */
+    template <typename U, typename oPolicy, typename = typename std::enable_if<
+        Maybe_Detail::IsMaybeConversion<T, Policy, Maybe<U, oPolicy>, const U&>::value &&
+        std::is_assignable<T&, const U&>::value>::type>
+    Maybe& operator=(const Maybe<U, oPolicy>& other) {
+        assignFrom(other);
+        return *this;
+    }
 
+    template <typename U, typename oPolicy, typename = typename std::enable_if<
+        Maybe_Detail::IsMaybeConversion<T, Policy, Maybe<U, oPolicy>, U&&>::value &&
+        std::is_assignable<T&, U&&>::value>::type>
+    Maybe& operator=(Maybe<U, oPolicy>&& other) {
+        assignFrom(std::move(other));
         return *this;
     }
 
@@ -167,60 +1278,282 @@ public:
      * operator can misbehave, and I do not want to require an object to
      * be default constructable.
      */
-    template <typename O>
-    Maybe<T>& operator=(const O& other) {
-        if (value == nullptr) {
-            value = alloc.allocate(1);
-            alloc.construct(value, other);
+    template <typename O, typename = typename std::enable_if<
+        !Maybe_Detail::IsReservedArg<Maybe, O>::value>::type>
+    Maybe& operator=(O&& other) {
+        if (!storage.has_value()) {
+            storage.construct(std::forward<O>(other));
+            MAYBE_RECORD(T, Policy, Constructions, 1);
         } else {
-            *value = other;
+            *storage.get() = std::forward<O>(other);
         }
 
         return *this;
     }
 
     /*!
-     * Assign with null pointer
+     * Destroys the current value, if there is one, and builds a new one
+     * in place from args.
      */
-    Maybe<T>& operator=(const std::nullptr_t& null_p) {
-        if (value != nullptr) {
-            alloc.destroy(value);
-        }
+    template <typename... Ts>
+    T& emplace(Ts&&... args) {
+        storage.reset();
+        storage.construct(std::forward<Ts>(args)...);
+        MAYBE_RECORD(T, Policy, Constructions, 1);
 
-        value = null_p;
+        return *storage.get();
+    }
+
+    /*!
+     * Assign with null pointer
+     */
+    Maybe& operator=(const std::nullptr_t&) {
+        storage.reset();
 
         return *this;
     }
 
+    /*!
+     * Exchanges the contents of two Maybes. Boxed Maybes swap pointers
+     * when their allocators allow it.
+     */
+    void swap(Maybe& other) noexcept(noexcept(storage.swap(other.storage))) {
+        storage.swap(other.storage);
+    }
+
     /*!
      * Checks if value can be extracted from this Maybe
      */
-    operator bool() const {
-        return value != nullptr;
+    constexpr operator bool() const {
+        return storage.has_value();
+    }
+
+    /*!
+     * Extracts the value from this Maybe, and throws and exception if we can't
+     */
+    constexpr T& operator()() {
+        if (*this) return *storage.get();
+        MAYBE_RECORD(T, Policy, EmptyAccesses, 1);
+        Maybe_Detail::throwNullMaybe();
     }
 
     /*!
      * Extracts the value from this Maybe, and throws and exception if we can't
      */
-    T& operator()() const {
-        if (*this) return *value;
-        else throw null_maybe_exception();
+    constexpr const T& operator()() const {
+        if (*this) return *storage.get();
+        MAYBE_RECORD(T, Policy, EmptyAccesses, 1);
+        Maybe_Detail::throwNullMaybe();
+    }
+
+    /*!
+     * Extracts the value without checking for it. Only for use once
+     * the Maybe is known to hold a value; debug builds assert on it.
+     */
+    constexpr T& operator*() & noexcept {
+        assert(storage.has_value());
+        return *storage.get();
+    }
+
+    constexpr const T& operator*() const& noexcept {
+        assert(storage.has_value());
+        return *storage.get();
+    }
+
+    constexpr T&& operator*() && noexcept {
+        assert(storage.has_value());
+        return std::move(*storage.get());
+    }
+
+    /*!
+     * Member access to the value without checking for it, same as
+     * operator*.
+     */
+    constexpr T* operator->() noexcept {
+        assert(storage.has_value());
+        return storage.get();
+    }
+
+    constexpr const T* operator->() const noexcept {
+        assert(storage.has_value());
+        return storage.get();
+    }
+
+    /*!
+     * Returns a pointer to the value, or a null pointer if there isn't one.
+     */
+    constexpr T* get_if() noexcept {
+        return storage.has_value() ? storage.get() : nullptr;
+    }
+
+    constexpr const T* get_if() const noexcept {
+        return storage.has_value() ? storage.get() : nullptr;
+    }
+
+    /*!
+     * Returns a copy of the value, or def converted to T if there
+     * isn't one.
+     */
+    template <typename U>
+    constexpr T value_or(U&& def) const& {
+        return storage.has_value() ? *storage.get() : static_cast<T>(std::forward<U>(def));
+    }
+
+    /*!
+     * Moves the value out, or returns def converted to T if there isn't one.
+     */
+    template <typename U>
+    constexpr T value_or(U&& def) && {
+        return storage.has_value() ? std::move(*storage.get()) : static_cast<T>(std::forward<U>(def));
+    }
+
+
+    /*!
+     * Monadic operations, after Haskell's fmap, >>= and friends. Each
+     * one passes the value to f as an lvalue, const lvalue or rvalue to
+     * match the Maybe it was called on, so chaining off a temporary
+     * moves the payload all the way through. An empty Maybe skips f and
+     * just produces another empty one.
+     *
+     *     Maybe<Config> config = readFile(path)
+     *         .and_then(parse)
+     *         .filter(isValid)
+     *         .map(applyDefaults)
+     *         .or_else(loadFallback);
+     */
+
+    /*!
+     * Applies f to the value, giving a Maybe of whatever f returns
+     */
+    template <typename F>
+    constexpr auto map(F&& f) & {
+        return mapImpl(*this, std::forward<F>(f));
+    }
+
+    template <typename F>
+    constexpr auto map(F&& f) const& {
+        return mapImpl(*this, std::forward<F>(f));
+    }
+
+    template <typename F>
+    constexpr auto map(F&& f) && {
+        return mapImpl(std::move(*this), std::forward<F>(f));
+    }
+
+    /*!
+     * Applies f, which itself returns a Maybe, to the value
+     */
+    template <typename F>
+    constexpr auto and_then(F&& f) & {
+        return andThenImpl(*this, std::forward<F>(f));
+    }
+
+    template <typename F>
+    constexpr auto and_then(F&& f) const& {
+        return andThenImpl(*this, std::forward<F>(f));
+    }
+
+    template <typename F>
+    constexpr auto and_then(F&& f) && {
+        return andThenImpl(std::move(*this), std::forward<F>(f));
+    }
+
+    /*!
+     * Returns this Maybe if it has a value, and the Maybe returned by
+     * f otherwise
+     */
+    template <typename F>
+    constexpr Maybe or_else(F&& f) const& {
+        return storage.has_value() ? *this : static_cast<Maybe>(std::forward<F>(f)());
+    }
+
+    template <typename F>
+    constexpr Maybe or_else(F&& f) && {
+        return storage.has_value() ? std::move(*this) : static_cast<Maybe>(std::forward<F>(f)());
+    }
+
+    /*!
+     * Keeps the value only if pred returns true for it
+     */
+    template <typename F>
+    constexpr Maybe filter(F&& pred) const& {
+        return storage.has_value() && std::forward<F>(pred)(*storage.get()) ? *this : Maybe();
+    }
+
+    template <typename F>
+    constexpr Maybe filter(F&& pred) && {
+        return storage.has_value() && std::forward<F>(pred)(*storage.get()) ? std::move(*this) : Maybe();
+    }
+
+    /*!
+     * Returns the value, or whatever f returns if there isn't one. Unlike
+     * value_or, the fallback is only computed when it is needed.
+     */
+    template <typename F>
+    constexpr T value_or_else(F&& f) const& {
+        return storage.has_value() ? *storage.get() : static_cast<T>(std::forward<F>(f)());
+    }
+
+    template <typename F>
+    constexpr T value_or_else(F&& f) && {
+        return storage.has_value() ? std::move(*storage.get()) : static_cast<T>(std::forward<F>(f)());
     }
 
 private:
-    template<typename oT>
-    typename std::enable_if<Maybe_Tests::EqualExists<T, oT>::value, bool>::type doEqualComparison(const Maybe<oT>& other) const {
-        return (*this)() == other();
+    /*!
+     * Builds T from the value of other, a Maybe of another type, if it
+     * has one. The storage must be empty.
+     */
+    template <typename Other>
+    void constructFrom(Other&& other) {
+        if (other) {
+            storage.construct(*std::forward<Other>(other));
+            MAYBE_RECORD(T, Policy, Constructions, 1);
+        }
+    }
+
+    template <typename Other>
+    void assignFrom(Other&& other) {
+        if (!other) {
+            storage.reset();
+        } else if (storage.has_value()) {
+            *storage.get() = *std::forward<Other>(other);
+        } else {
+            constructFrom(std::forward<Other>(other));
+        }
+    }
+
+    template <typename Self, typename F>
+    static constexpr auto mapImpl(Self&& self, F&& f) {
+        typedef decltype(*std::forward<Self>(self)) Arg;
+        typedef typename std::remove_cv<typename std::remove_reference<
+            typename std::invoke_result<F, Arg>::type>::type>::type U;
+        static_assert(!std::is_void<U>::value, "Maybe::map needs a function which returns a value");
+
+        if (!self) {
+            return Maybe<U>();
+        }
+        return Maybe<U>(std::in_place, std::forward<F>(f)(*std::forward<Self>(self)));
     }
-    template<typename oT>
-    typename std::enable_if<!Maybe_Tests::EqualExists<T, oT>::value, bool>::type doEqualComparison(const Maybe<oT>& other) const {
-        return false;
+
+    template <typename Self, typename F>
+    static constexpr auto andThenImpl(Self&& self, F&& f) {
+        typedef decltype(*std::forward<Self>(self)) Arg;
+        typedef typename std::remove_cv<typename std::remove_reference<
+            typename std::invoke_result<F, Arg>::type>::type>::type R;
+        static_assert(Maybe_Detail::IsMaybe<R>::value, "Maybe::and_then needs a function which returns a Maybe");
+
+        if (!self) {
+            return R();
+        }
+        return R(std::forward<F>(f)(*std::forward<Self>(self)));
     }
 
 public:
 
     /*!
-     * Compares two Maybe objects
+     * Compares two Maybe objects. The storage policies do not need to
+     * match.
      *
      * Truth table (a and b are aribitrary values of type T s.t. a != b
      * and c and d are of type oT s.t. c == a and d != a; nullptr<T> means
@@ -238,26 +1571,593 @@ public:
      * | nullptr<T>  | nullptr<oT> | false |
      * +-------------+-------------+-------+
      */
-    template<typename oT>
-    bool operator==(const Maybe<oT>& other) const {
-        if ((*this && !other) || (!*this && other)) {
-            return false;
+    template<typename oT, typename oPolicy>
+    constexpr bool operator==(const Maybe<oT, oPolicy>& other) const {
+        if constexpr (Maybe_Detail::BranchFreeEqual<T, Policy, oT, oPolicy>::value) {
+            // both payloads are always readable, so compare them
+            // unconditionally and fold the flags in with bitwise ops
+            bool a = storage.has_value();
+            bool b = other.storage.has_value();
+            bool same = std::is_same<T, oT>::value;
+            return (a & b & (storage.raw() == other.storage.raw())) | (!(a | b) & same);
+        } else {
+            return Maybe_Detail::equalMaybes<T, oT>(*this, other);
         }
+    }
+
+    /*
+     * != operator which leverages == operator
+     */
+    template<typename oT, typename oPolicy>
+    constexpr bool operator!=(const Maybe<oT, oPolicy>& other) const {
+        return !(*this == other);
+    }
+};
+
+/*!
+ * A Maybe of a reference, which is nothing but a pointer that may be
+ * null. It never copies or allocates the object it refers to, and a
+ * const Maybe<T&> still gives mutable access to a non-const T, the same
+ * as a const pointer would.
+ *
+ *     Maybe<const Entry&> find(const Key& k);
+ *
+ *     Maybe<const Entry&> e = find(k);
+ *     if (e) {
+ *         use(e());
+ *     }
+ *
+ * Assigning a T to it would be ambiguous between rebinding and
+ * assigning through, so it is not allowed. Rebinding is spelled out
+ * with rebind(), or by assigning another Maybe<T&>, and nullptr empties
+ * it. It cannot bind to a temporary.
+ */
+template <typename T>
+class Maybe<T&, MaybeInline> {
+
+    template <typename, typename>
+    friend class Maybe;
+
+    T* ptr;
+
+public:
+    /*!
+     * Constructs an empty maybe
+     */
+    constexpr Maybe() noexcept : ptr(nullptr) {}
+
+    /*!
+     * Construct with null pointer
+     */
+    constexpr Maybe(const std::nullptr_t&) noexcept : ptr(nullptr) {}
+
+    /*!
+     * Refers to ref, which must outlive the Maybe
+     */
+    template <typename U, typename = typename std::enable_if<
+        std::is_convertible<U*, T*>::value>::type>
+    constexpr Maybe(U& ref) noexcept : ptr(std::addressof(ref)) {}
+
+    template <typename U, typename = typename std::enable_if<
+        !Maybe_Detail::IsReservedArg<Maybe, U>::value &&
+        !Maybe_Detail::IsMaybe<typename std::decay<U>::type>::value>::type>
+    Maybe(const U&&) = delete;
+
+    /*!
+     * Refers to whatever other refers to, e.g. a Maybe<Derived&> as a
+     * Maybe<const Base&>
+     */
+    template <typename U, typename = typename std::enable_if<
+        !std::is_same<U, T>::value && std::is_convertible<U*, T*>::value>::type>
+    constexpr Maybe(const Maybe<U&, MaybeInline>& other) noexcept : ptr(other.ptr) {}
+
+    Maybe(const Maybe& other) = default;
+    Maybe& operator=(const Maybe& other) = default;
+
+    template <typename U, typename = typename std::enable_if<
+        !Maybe_Detail::IsReservedArg<Maybe, U>::value &&
+        !Maybe_Detail::IsMaybe<typename std::decay<U>::type>::value>::type>
+    Maybe& operator=(U&&) = delete;
+
+    /*!
+     * Assign with null pointer
+     */
+    Maybe& operator=(const std::nullptr_t&) noexcept {
+        ptr = nullptr;
+
+        return *this;
+    }
+
+    /*!
+     * Makes this Maybe refer to ref instead
+     */
+    template <typename U, typename = typename std::enable_if<
+        std::is_convertible<U*, T*>::value>::type>
+    T& rebind(U& ref) noexcept {
+        ptr = std::addressof(ref);
+
+        return *ptr;
+    }
+
+    template <typename U>
+    void rebind(const U&&) = delete;
+
+    void swap(Maybe& other) noexcept {
+        std::swap(ptr, other.ptr);
+    }
+
+    /*!
+     * Checks if value can be extracted from this Maybe
+     */
+    constexpr operator bool() const noexcept {
+        return ptr != nullptr;
+    }
+
+    /*!
+     * Extracts the value from this Maybe, and throws and exception if we can't
+     */
+    constexpr T& operator()() const {
+        if (ptr != nullptr) return *ptr;
+        MAYBE_RECORD(T&, MaybeInline, EmptyAccesses, 1);
+        Maybe_Detail::throwNullMaybe();
+    }
+
+    /*!
+     * Extracts the value without checking for it. Only for use once
+     * the Maybe is known to hold a value; debug builds assert on it.
+     */
+    constexpr T& operator*() const noexcept {
+        assert(ptr != nullptr);
+        return *ptr;
+    }
 
-        if (!*this && !other) {
-            return std::is_same<T, oT>::value;
+    constexpr T* operator->() const noexcept {
+        assert(ptr != nullptr);
+        return ptr;
+    }
+
+    /*!
+     * Returns a pointer to the value, or a null pointer if there isn't one.
+     */
+    constexpr T* get_if() const noexcept {
+        return ptr;
+    }
+
+    /*!
+     * Returns a copy of the value, or def converted to one if there
+     * isn't one.
+     */
+    template <typename U>
+    constexpr typename std::remove_cv<T>::type value_or(U&& def) const {
+        return ptr != nullptr ? *ptr : static_cast<typename std::remove_cv<T>::type>(std::forward<U>(def));
+    }
+
+    /*!
+     * Applies f to the value, giving a Maybe of whatever f returns
+     */
+    template <typename F>
+    constexpr auto map(F&& f) const {
+        typedef typename std::remove_cv<typename std::remove_reference<
+            typename std::invoke_result<F, T&>::type>::type>::type U;
+        static_assert(!std::is_void<U>::value, "Maybe::map needs a function which returns a value");
+
+        if (ptr == nullptr) {
+            return Maybe<U>();
         }
+        return Maybe<U>(std::in_place, std::forward<F>(f)(*ptr));
+    }
+
+    /*!
+     * Applies f, which itself returns a Maybe, to the value
+     */
+    template <typename F>
+    constexpr auto and_then(F&& f) const {
+        typedef typename std::remove_cv<typename std::remove_reference<
+            typename std::invoke_result<F, T&>::type>::type>::type R;
+        static_assert(Maybe_Detail::IsMaybe<R>::value, "Maybe::and_then needs a function which returns a Maybe");
 
-        return doEqualComparison(other);
+        if (ptr == nullptr) {
+            return R();
+        }
+        return R(std::forward<F>(f)(*ptr));
     }
 
-    /*
-     * != operator which leverages == operator
+    /*!
+     * Compares the referred-to values, with the same truth table as
+     * the primary template. For that table a Maybe<T&> counts as a
+     * Maybe<T> without its cv qualifiers, so an empty Maybe<const int&>
+     * equals an empty Maybe<int>.
      */
-    template<typename oT>
-    bool operator!=(const Maybe<oT>& other) const {
+    template<typename oT, typename oPolicy>
+    constexpr bool operator==(const Maybe<oT, oPolicy>& other) const {
+        return Maybe_Detail::equalMaybes<T&, oT>(*this, other);
+    }
+
+    template<typename oT, typename oPolicy>
+    constexpr bool operator!=(const Maybe<oT, oPolicy>& other) const {
         return !(*this == other);
     }
 };
 
+/*!
+ * Found by ADL, so `using std::swap; swap(a, b);` exchanges the
+ * storage directly instead of going through a temporary Maybe.
+ */
+template <typename T, typename Policy>
+void swap(Maybe<T, Policy>& a, Maybe<T, Policy>& b) noexcept(noexcept(a.swap(b))) {
+    a.swap(b);
+}
+
+namespace Maybe_Detail
+{
+  /*!
+   * True when U is a bare value a Maybe of T can be compared against
+   * directly: not a Maybe, a Maybe proxy or nullptr, and comparable with
+   * T using ==.
+   */
+  template <typename T, typename U>
+  struct IsBareOperand : std::integral_constant<bool,
+      !IsMaybe<U>::value && !IsMaybeProxy<U>::value && !std::is_same<U, std::nullptr_t>::value &&
+      Maybe_Tests::EqualExists<typename std::remove_reference<T>::type, U>::value> {};
+
+  template <typename T, typename U>
+  using EnableIfBare = typename std::enable_if<IsBareOperand<T, U>::value>::type;
+
+  /*!
+   * True when T is a std::basic_string and U converts to its
+   * basic_string_view, which hashes the same as the string would
+   */
+  template <typename T, typename U>
+  struct IsStringLike : std::false_type {};
+
+  template <typename C, typename Tr, typename A, typename U>
+  struct IsStringLike<std::basic_string<C, Tr, A>, U>
+      : std::is_convertible<const U&, std::basic_string_view<C, Tr> > {
+      typedef std::basic_string_view<C, Tr> view;
+  };
+
+  template <typename T, typename oT>
+  using LessResult = decltype(bool(std::declval<const typename std::remove_reference<T>::type&>() <
+                                   std::declval<const typename std::remove_reference<oT>::type&>()));
+}
+
+/*!
+ * Compares a Maybe with a bare value, without building a Maybe out of
+ * it: equal when the Maybe holds a value equal to v. Compared with
+ * nullptr, a Maybe is equal when it is empty.
+ *
+ *     Maybe<std::string> name = ...;
+ *     if (name == "root") { ... }   //no std::string is made
+ */
+template <typename T, typename Policy, typename U, typename = Maybe_Detail::EnableIfBare<T, U> >
+constexpr bool operator==(const Maybe<T, Policy>& m, const U& v) {
+    return m && *m == v;
+}
+
+template <typename T, typename Policy, typename U, typename = Maybe_Detail::EnableIfBare<T, U> >
+constexpr bool operator==(const U& v, const Maybe<T, Policy>& m) {
+    return m && *m == v;
+}
+
+template <typename T, typename Policy, typename U, typename = Maybe_Detail::EnableIfBare<T, U> >
+constexpr bool operator!=(const Maybe<T, Policy>& m, const U& v) {
+    return !(m == v);
+}
+
+template <typename T, typename Policy, typename U, typename = Maybe_Detail::EnableIfBare<T, U> >
+constexpr bool operator!=(const U& v, const Maybe<T, Policy>& m) {
+    return !(m == v);
+}
+
+template <typename T, typename Policy>
+constexpr bool operator==(const Maybe<T, Policy>& m, std::nullptr_t) {
+    return !m;
+}
+
+template <typename T, typename Policy>
+constexpr bool operator==(std::nullptr_t, const Maybe<T, Policy>& m) {
+    return !m;
+}
+
+template <typename T, typename Policy>
+constexpr bool operator!=(const Maybe<T, Policy>& m, std::nullptr_t) {
+    return static_cast<bool>(m);
+}
+
+template <typename T, typename Policy>
+constexpr bool operator!=(std::nullptr_t, const Maybe<T, Policy>& m) {
+    return static_cast<bool>(m);
+}
+
+/*!
+ * Orders Maybes the way std::optional is ordered: an empty Maybe comes
+ * before any value, and two values compare with <. Unlike ==, two empty
+ * Maybes of different types are equivalent here, since neither comes
+ * first.
+ */
+template <typename T, typename Policy, typename oT, typename oPolicy, typename = Maybe_Detail::LessResult<T, oT> >
+constexpr bool operator<(const Maybe<T, Policy>& a, const Maybe<oT, oPolicy>& b) {
+    return b && (!a || *a < *b);
+}
+
+template <typename T, typename Policy, typename oT, typename oPolicy, typename = Maybe_Detail::LessResult<T, oT> >
+constexpr bool operator>(const Maybe<T, Policy>& a, const Maybe<oT, oPolicy>& b) {
+    return b < a;
+}
+
+template <typename T, typename Policy, typename oT, typename oPolicy, typename = Maybe_Detail::LessResult<T, oT> >
+constexpr bool operator<=(const Maybe<T, Policy>& a, const Maybe<oT, oPolicy>& b) {
+    return !(b < a);
+}
+
+template <typename T, typename Policy, typename oT, typename oPolicy, typename = Maybe_Detail::LessResult<T, oT> >
+constexpr bool operator>=(const Maybe<T, Policy>& a, const Maybe<oT, oPolicy>& b) {
+    return !(a < b);
+}
+
+/*!
+ * Orders a Maybe against a bare value, as if the value were in a Maybe
+ */
+template <typename T, typename Policy, typename U, typename = Maybe_Detail::EnableIfBare<T, U>,
+          typename = Maybe_Detail::LessResult<T, U> >
+constexpr bool operator<(const Maybe<T, Policy>& m, const U& v) {
+    return !m || *m < v;
+}
+
+template <typename T, typename Policy, typename U, typename = Maybe_Detail::EnableIfBare<T, U>,
+          typename = Maybe_Detail::LessResult<U, T> >
+constexpr bool operator<(const U& v, const Maybe<T, Policy>& m) {
+    return m && v < *m;
+}
+
+template <typename T, typename Policy, typename U, typename = Maybe_Detail::EnableIfBare<T, U>,
+          typename = Maybe_Detail::LessResult<U, T> >
+constexpr bool operator>(const Maybe<T, Policy>& m, const U& v) {
+    return v < m;
+}
+
+template <typename T, typename Policy, typename U, typename = Maybe_Detail::EnableIfBare<T, U>,
+          typename = Maybe_Detail::LessResult<T, U> >
+constexpr bool operator>(const U& v, const Maybe<T, Policy>& m) {
+    return m < v;
+}
+
+template <typename T, typename Policy, typename U, typename = Maybe_Detail::EnableIfBare<T, U>,
+          typename = Maybe_Detail::LessResult<U, T> >
+constexpr bool operator<=(const Maybe<T, Policy>& m, const U& v) {
+    return !(v < m);
+}
+
+template <typename T, typename Policy, typename U, typename = Maybe_Detail::EnableIfBare<T, U>,
+          typename = Maybe_Detail::LessResult<T, U> >
+constexpr bool operator<=(const U& v, const Maybe<T, Policy>& m) {
+    return !(m < v);
+}
+
+template <typename T, typename Policy, typename U, typename = Maybe_Detail::EnableIfBare<T, U>,
+          typename = Maybe_Detail::LessResult<T, U> >
+constexpr bool operator>=(const Maybe<T, Policy>& m, const U& v) {
+    return !(m < v);
+}
+
+template <typename T, typename Policy, typename U, typename = Maybe_Detail::EnableIfBare<T, U>,
+          typename = Maybe_Detail::LessResult<U, T> >
+constexpr bool operator>=(const U& v, const Maybe<T, Policy>& m) {
+    return !(v < m);
+}
+
+namespace Maybe_Detail
+{
+  /*!
+   * Enables the bare value comparisons below for a Maybe proxy P, which
+   * would otherwise compare its conversion to bool against the value
+   */
+  template <typename P, typename U>
+  using EnableIfProxyBare = EnableIfBare<typename P::maybe_proxy_of, U>;
+}
+
+/*!
+ * Compares a Maybe proxy, such as an element of a MaybeVector, with a
+ * bare value or nullptr, the same way as a Maybe
+ */
+template <typename P, typename U, typename = Maybe_Detail::EnableIfProxyBare<P, U> >
+constexpr bool operator==(const P& p, const U& v) {
+    return p && *p == v;
+}
+
+template <typename P, typename U, typename = Maybe_Detail::EnableIfProxyBare<P, U> >
+constexpr bool operator==(const U& v, const P& p) {
+    return p && *p == v;
+}
+
+template <typename P, typename U, typename = Maybe_Detail::EnableIfProxyBare<P, U> >
+constexpr bool operator!=(const P& p, const U& v) {
+    return !(p == v);
+}
+
+template <typename P, typename U, typename = Maybe_Detail::EnableIfProxyBare<P, U> >
+constexpr bool operator!=(const U& v, const P& p) {
+    return !(p == v);
+}
+
+template <typename P, typename = typename std::enable_if<Maybe_Detail::IsMaybeProxy<P>::value>::type>
+constexpr bool operator==(const P& p, std::nullptr_t) {
+    return !p;
+}
+
+template <typename P, typename = typename std::enable_if<Maybe_Detail::IsMaybeProxy<P>::value>::type>
+constexpr bool operator==(std::nullptr_t, const P& p) {
+    return !p;
+}
+
+template <typename P, typename = typename std::enable_if<Maybe_Detail::IsMaybeProxy<P>::value>::type>
+constexpr bool operator!=(const P& p, std::nullptr_t) {
+    return static_cast<bool>(p);
+}
+
+template <typename P, typename = typename std::enable_if<Maybe_Detail::IsMaybeProxy<P>::value>::type>
+constexpr bool operator!=(std::nullptr_t, const P& p) {
+    return static_cast<bool>(p);
+}
+
+template <typename P, typename U, typename = Maybe_Detail::EnableIfProxyBare<P, U>,
+          typename = Maybe_Detail::LessResult<typename P::maybe_proxy_of, U> >
+constexpr bool operator<(const P& p, const U& v) {
+    return !p || *p < v;
+}
+
+template <typename P, typename U, typename = Maybe_Detail::EnableIfProxyBare<P, U>,
+          typename = Maybe_Detail::LessResult<U, typename P::maybe_proxy_of> >
+constexpr bool operator<(const U& v, const P& p) {
+    return p && v < *p;
+}
+
+template <typename P, typename U, typename = Maybe_Detail::EnableIfProxyBare<P, U>,
+          typename = Maybe_Detail::LessResult<U, typename P::maybe_proxy_of> >
+constexpr bool operator>(const P& p, const U& v) {
+    return v < p;
+}
+
+template <typename P, typename U, typename = Maybe_Detail::EnableIfProxyBare<P, U>,
+          typename = Maybe_Detail::LessResult<typename P::maybe_proxy_of, U> >
+constexpr bool operator>(const U& v, const P& p) {
+    return p < v;
+}
+
+template <typename P, typename U, typename = Maybe_Detail::EnableIfProxyBare<P, U>,
+          typename = Maybe_Detail::LessResult<U, typename P::maybe_proxy_of> >
+constexpr bool operator<=(const P& p, const U& v) {
+    return !(v < p);
+}
+
+template <typename P, typename U, typename = Maybe_Detail::EnableIfProxyBare<P, U>,
+          typename = Maybe_Detail::LessResult<typename P::maybe_proxy_of, U> >
+constexpr bool operator<=(const U& v, const P& p) {
+    return !(p < v);
+}
+
+template <typename P, typename U, typename = Maybe_Detail::EnableIfProxyBare<P, U>,
+          typename = Maybe_Detail::LessResult<typename P::maybe_proxy_of, U> >
+constexpr bool operator>=(const P& p, const U& v) {
+    return !(p < v);
+}
+
+template <typename P, typename U, typename = Maybe_Detail::EnableIfProxyBare<P, U>,
+          typename = Maybe_Detail::LessResult<U, typename P::maybe_proxy_of> >
+constexpr bool operator>=(const U& v, const P& p) {
+    return !(v < p);
+}
+
+#if defined(__cpp_lib_three_way_comparison) && __cpp_lib_three_way_comparison >= 201907L
+/*!
+ * Three-way comparison, with the same order as operator<
+ */
+template <typename T, typename Policy, typename oT, typename oPolicy>
+    requires std::three_way_comparable_with<typename std::remove_reference<T>::type,
+                                            typename std::remove_reference<oT>::type>
+constexpr std::compare_three_way_result_t<typename std::remove_reference<T>::type, typename std::remove_reference<oT>::type>
+operator<=>(const Maybe<T, Policy>& a, const Maybe<oT, oPolicy>& b) {
+    if (a && b) {
+        return *a <=> *b;
+    }
+    return static_cast<bool>(a) <=> static_cast<bool>(b);
+}
+
+template <typename T, typename Policy, typename U>
+    requires Maybe_Detail::IsBareOperand<T, U>::value &&
+             std::three_way_comparable_with<typename std::remove_reference<T>::type, U>
+constexpr std::compare_three_way_result_t<typename std::remove_reference<T>::type, U>
+operator<=>(const Maybe<T, Policy>& m, const U& v) {
+    if (m) {
+        return *m <=> v;
+    }
+    return std::strong_ordering::less;
+}
+#endif
+
+/*!
+ * Hashes a Maybe as the std::hash of its value, and an empty one as a
+ * fixed constant, so that a bare value hashes the same as a Maybe
+ * holding it. It is transparent, so unordered containers keyed on
+ * Maybe<T> can be searched with a bare key (or nullptr) without
+ * building a Maybe, together with std::equal_to<> (C++20):
+ *
+ *     std::unordered_map<Maybe<std::string>, int, maybe_hash<std::string>, std::equal_to<> > counts;
+ *     auto it = counts.find(std::string_view(name));
+ *
+ * For a Maybe of a std::basic_string, anything convertible to the
+ * matching string_view is hashed as one, with no copy. Other bare keys
+ * are hashed with std::hash<U> when U is T, and converted to T first
+ * otherwise.
+ */
+template <typename T>
+struct maybe_hash {
+    typedef void is_transparent;
+    typedef typename std::remove_cv<typename std::remove_reference<T>::type>::type value_type;
+
+    static constexpr std::size_t emptyHash = static_cast<std::size_t>(0x9e3779b97f4a7c15ull);
+
+    template <typename Policy>
+    std::size_t operator()(const Maybe<T, Policy>& m) const {
+        return m ? std::hash<value_type>()(*m) : emptyHash;
+    }
+
+    std::size_t operator()(std::nullptr_t) const {
+        return emptyHash;
+    }
+
+    template <typename U, typename = Maybe_Detail::EnableIfBare<T, U> >
+    std::size_t operator()(const U& v) const {
+        if constexpr (std::is_same<U, value_type>::value) {
+            return std::hash<value_type>()(v);
+        } else if constexpr (Maybe_Detail::IsStringLike<value_type, U>::value) {
+            return std::hash<typename Maybe_Detail::IsStringLike<value_type, U>::view>()(v);
+        } else {
+            return std::hash<value_type>()(value_type(v));
+        }
+    }
+};
+
+/*!
+ * Hashes Maybes the same way as maybe_hash, so they can be used as keys
+ * in unordered containers as they are
+ */
+template <typename T, typename Policy>
+struct std::hash<Maybe<T, Policy> > : maybe_hash<T> {};
+
+/*!
+ * Marks types whose objects can be moved to a new address with a plain
+ * memcpy, leaving nothing to be destroyed at the old one. Containers can
+ * use it to relocate elements in bulk instead of moving and destroying
+ * them one at a time.
+ *
+ * Trivially copyable types qualify on their own. Others, such as types
+ * holding only a unique_ptr, can opt in by specializing it with value
+ * set to true.
+ */
+template <typename T>
+struct maybe_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+/*!
+ * An inline Maybe is relocatable exactly when its value is, and a boxed
+ * one is just a pointer next to its allocator.
+ */
+template <typename T>
+struct maybe_trivially_relocatable<Maybe<T, MaybeInline> >
+    : std::integral_constant<bool, maybe_trivially_relocatable<T>::value> {};
+
+template <typename T, typename A>
+struct maybe_trivially_relocatable<Maybe<T, MaybeBoxed<A> > >
+    : std::integral_constant<bool, maybe_trivially_relocatable<
+          typename std::allocator_traits<A>::template rebind_alloc<T> >::value &&
+          maybe_trivially_relocatable<typename std::allocator_traits<
+              typename std::allocator_traits<A>::template rebind_alloc<T> >::pointer>::value> {};
+
+template <typename T>
+struct maybe_trivially_relocatable<std::allocator<T> > : std::true_type {};
+
+template <typename T, typename D>
+struct maybe_trivially_relocatable<std::unique_ptr<T, D> >
+    : std::integral_constant<bool, maybe_trivially_relocatable<D>::value> {};
+
 #endif
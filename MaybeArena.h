@@ -0,0 +1,158 @@
+#ifndef MAYBE_ARENA_H
+#define MAYBE_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+#include "Maybe.h"
+
+/*!
+ * A monotonic arena. Memory handed out by allocate() is never given
+ * back one piece at a time; release() frees all of it at once, as does
+ * the destructor.
+ *
+ * It is meant for boxed Maybes that only live for the duration of one
+ * request:
+ *
+ *     MaybeArena arena;
+ *     MaybeArenaAllocator<Message> alloc(arena);
+ *
+ *     Maybe<Message, MaybeArenaBoxed> m(std::allocator_arg, alloc, bytes);
+ *     ...
+ *     //once every Maybe using the arena is gone
+ *     arena.release();
+ *
+ * The arena is not thread safe.
+ */
+class MaybeArena {
+
+    struct Block {
+        Block* next;
+        std::size_t size;
+    };
+
+    Block* head;
+    char* cur;
+    char* end;
+    std::size_t blockSize;
+
+    static std::size_t headerSize() {
+        return (sizeof(Block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    }
+
+    /*!
+     * Gets a fresh block big enough for bytes at the given alignment and
+     * makes it the current one.
+     */
+    void grow(std::size_t bytes, std::size_t align) {
+        std::size_t size = bytes + align > blockSize ? bytes + align : blockSize;
+        Block* block = static_cast<Block*>(::operator new(headerSize() + size));
+        block->next = head;
+        block->size = size;
+        head = block;
+        cur = reinterpret_cast<char*>(block) + headerSize();
+        end = cur + size;
+    }
+
+public:
+    /*!
+     * Creates an empty arena which grabs memory from the global heap in
+     * blocks of at least blockSize bytes.
+     */
+    explicit MaybeArena(std::size_t blockSize = 4096)
+        : head(nullptr), cur(nullptr), end(nullptr), blockSize(blockSize) {}
+
+    MaybeArena(const MaybeArena&) = delete;
+    MaybeArena& operator=(const MaybeArena&) = delete;
+
+    /*!
+     * Frees every block the arena has handed out
+     */
+    ~MaybeArena() {
+        release();
+    }
+
+    /*!
+     * Carves bytes out of the current block, starting a new one if it
+     * does not have enough room left.
+     */
+    void* allocate(std::size_t bytes, std::size_t align) {
+        std::uintptr_t p = (reinterpret_cast<std::uintptr_t>(cur) + align - 1) & ~(std::uintptr_t)(align - 1);
+        if (cur == nullptr || p + bytes > reinterpret_cast<std::uintptr_t>(end)) {
+            grow(bytes, align);
+            p = (reinterpret_cast<std::uintptr_t>(cur) + align - 1) & ~(std::uintptr_t)(align - 1);
+        }
+        cur = reinterpret_cast<char*>(p + bytes);
+        return reinterpret_cast<void*>(p);
+    }
+
+    /*!
+     * Frees everything allocated from this arena in one go. Any Maybe
+     * still using the arena must already have been destroyed.
+     */
+    void release() {
+        while (head != nullptr) {
+            Block* next = head->next;
+            MAYBE_UNPOISON(head, headerSize() + head->size);
+            ::operator delete(head);
+            head = next;
+        }
+        cur = nullptr;
+        end = nullptr;
+    }
+};
+
+/*!
+ * Allocator adapter which takes memory from a MaybeArena. Deallocation
+ * does nothing; the memory comes back when the arena is released.
+ *
+ * Like std::pmr allocators it does not propagate on copy, move or swap,
+ * so a Maybe stays in the arena it was created in.
+ */
+template <typename T>
+class MaybeArenaAllocator {
+
+    template <typename U>
+    friend class MaybeArenaAllocator;
+
+    MaybeArena* arena;
+
+public:
+    typedef T value_type;
+
+    MaybeArenaAllocator(MaybeArena& arena) : arena(&arena) {}
+
+    template <typename U>
+    MaybeArenaAllocator(const MaybeArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    /*!
+     * Under AddressSanitizer the memory is poisoned, so anything still
+     * pointing at it is caught, even though the arena keeps it
+     */
+    void deallocate(T* p, std::size_t n) {
+        MAYBE_POISON(p, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const MaybeArenaAllocator<U>& other) const {
+        return arena == other.arena;
+    }
+
+    template <typename U>
+    bool operator!=(const MaybeArenaAllocator<U>& other) const {
+        return arena != other.arena;
+    }
+};
+
+/*!
+ * Storage policy for Maybes boxed inside a MaybeArena
+ */
+typedef MaybeBoxed<MaybeArenaAllocator<char> > MaybeArenaBoxed;
+
+#endif
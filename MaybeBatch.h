@@ -0,0 +1,305 @@
+#ifndef MAYBE_BATCH_H
+#define MAYBE_BATCH_H
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "Maybe.h"
+#include "MaybeArena.h"
+
+namespace Maybe_Detail
+{
+  /*!
+   * Builds one Maybe at where from a source element, which may be a
+   * Maybe, a Maybe proxy, nullptr, or anything the value can be built
+   * from. prefix is passed first, so that boxed Maybes can be handed
+   * their allocator.
+   */
+  template <typename T, typename Policy, typename Src, typename... Prefix>
+  void constructFromSource(Maybe<T, Policy>* where, Src&& src, Prefix&&... prefix) {
+      typedef typename std::decay<Src>::type S;
+
+      if constexpr (IsMaybe<S>::value || IsMaybeProxy<S>::value) {
+          if (src) {
+              ::new (static_cast<void*>(where)) Maybe<T, Policy>(std::forward<Prefix>(prefix)..., *src);
+          } else {
+              ::new (static_cast<void*>(where)) Maybe<T, Policy>(std::forward<Prefix>(prefix)...);
+          }
+      } else if constexpr (std::is_same<S, std::nullptr_t>::value) {
+          ::new (static_cast<void*>(where)) Maybe<T, Policy>(std::forward<Prefix>(prefix)...);
+      } else if constexpr (sizeof...(Prefix) == 0) {
+          ::new (static_cast<void*>(where)) Maybe<T, Policy>(std::in_place, std::forward<Src>(src));
+      } else {
+          ::new (static_cast<void*>(where)) Maybe<T, Policy>(std::forward<Prefix>(prefix)..., std::forward<Src>(src));
+      }
+  }
+
+  /*!
+   * Whether a batch of Maybe<T, Policy> can be dropped without running
+   * any destructors. True for inline Maybes of trivially destructible
+   * types, and for arena boxed ones whose values are, since the arena
+   * frees their memory all at once anyway. The arena case is skipped
+   * when instrumented, so that the frees are still counted.
+   */
+  template <typename T, typename Policy>
+  struct TrivialBatchDestroy : std::is_trivially_destructible<Maybe<T, Policy> > {};
+
+  template <typename T>
+  struct TrivialBatchDestroy<T, MaybeArenaBoxed>
+      : std::integral_constant<bool, std::is_trivially_destructible<T>::value && !MAYBE_INSTRUMENTATION> {};
+}
+
+/*!
+ * Destroys the n Maybes starting at first in a single pass, like
+ * std::destroy_n. When that would do nothing (see
+ * Maybe_Detail::TrivialBatchDestroy) no destructor is run at all.
+ */
+template <typename T, typename Policy, typename Size>
+void maybe_destroy_n(Maybe<T, Policy>* first, Size n) {
+    if constexpr (!Maybe_Detail::TrivialBatchDestroy<T, Policy>::value) {
+        for (Size i = 0; i < n; ++i) {
+            first[i].~Maybe<T, Policy>();
+        }
+    }
+}
+
+namespace Maybe_Detail
+{
+  /*!
+   * Builds n Maybes at out from first, undoing them all if one throws
+   */
+  template <typename T, typename Policy, typename InputIt, typename Size, typename... Prefix>
+  InputIt constructBatch(InputIt first, Size n, Maybe<T, Policy>* out, const Prefix&... prefix) {
+      Size built = 0;
+#if MAYBE_EXCEPTIONS
+      try {
+          for (; built < n; ++built, ++first) {
+              constructFromSource(out + built, *first, prefix...);
+          }
+      } catch (...) {
+          maybe_destroy_n(out, built);
+          throw;
+      }
+#else
+      for (; built < n; ++built, ++first) {
+          constructFromSource(out + built, *first, prefix...);
+      }
+#endif
+      return first;
+  }
+}
+
+/*!
+ * Builds n Maybes in the uninitialized memory at out from the next n
+ * elements of first, like std::uninitialized_copy_n. Elements may be
+ * Maybes, Maybe proxies, nullptr, or anything T can be built from. If
+ * building one throws, those already built are destroyed again.
+ *
+ * Returns the input iterator past the last element used.
+ */
+template <typename InputIt, typename Size, typename T, typename Policy>
+InputIt maybe_uninitialized_construct_n(InputIt first, Size n, Maybe<T, Policy>* out) {
+    return Maybe_Detail::constructBatch(first, n, out);
+}
+
+/*!
+ * As above, for boxed Maybes whose values are allocated from alloc
+ */
+template <typename A, typename InputIt, typename Size, typename T, typename Policy>
+InputIt maybe_uninitialized_construct_n(std::allocator_arg_t, const A& alloc, InputIt first, Size n, Maybe<T, Policy>* out) {
+    return Maybe_Detail::constructBatch(first, n, out, std::allocator_arg, alloc);
+}
+
+namespace Maybe_Detail
+{
+  /*!
+   * Where a MaybeArray keeps the values of its elements. Inline and
+   * other boxed Maybes need nothing extra.
+   */
+  template <typename Policy>
+  class BatchPayloads {
+
+  public:
+      explicit BatchPayloads(std::size_t, std::size_t) {}
+
+      template <typename T, typename InputIt>
+      InputIt construct(InputIt first, std::size_t n, Maybe<T, Policy>* out) {
+          return maybe_uninitialized_construct_n(first, n, out);
+      }
+  };
+
+  /*!
+   * Arena boxed elements get an arena of their own, sized so that all of
+   * their values fit in its first block.
+   */
+  template <>
+  class BatchPayloads<MaybeArenaBoxed> {
+
+      std::unique_ptr<MaybeArena> arena;
+
+  public:
+      BatchPayloads(std::size_t n, std::size_t size) : arena(new MaybeArena(n * size + alignof(std::max_align_t))) {}
+
+      template <typename T, typename InputIt>
+      InputIt construct(InputIt first, std::size_t n, Maybe<T, MaybeArenaBoxed>* out) {
+          return maybe_uninitialized_construct_n(std::allocator_arg, MaybeArenaAllocator<T>(*arena), first, n, out);
+      }
+  };
+}
+
+/*!
+ * A fixed size array of Maybe<T, Policy> built in one go from a range,
+ * for when a whole batch of optional values is made and dropped
+ * together, such as the rows of a decoded message.
+ *
+ *     MaybeArray<Row, MaybeArenaBoxed> rows = make_maybe_array<Row, MaybeArenaBoxed>(decoded);
+ *
+ *     for (const Maybe<Row, MaybeArenaBoxed>& r : rows) {
+ *         ...
+ *     }
+ *
+ * The elements sit in a single allocation. With MaybeArenaBoxed their
+ * values all come from one contiguous block as well, owned by the array,
+ * so building n of them costs a constant number of allocator calls
+ * rather than n. Values later assigned to an emptied element are taken
+ * from the same arena, and none of the memory is given back until the
+ * array is destroyed, so an element's value must not be moved out into
+ * a Maybe that outlives it.
+ *
+ * Destruction is one pass over the elements, or none at all when their
+ * destructors would do nothing.
+ */
+template <typename T, typename Policy = MaybeInline>
+class MaybeArray : private Maybe_Detail::BatchPayloads<Policy> {
+
+    typedef Maybe_Detail::BatchPayloads<Policy> Payloads;
+
+public:
+    typedef Maybe<T, Policy> value_type;
+    typedef std::size_t size_type;
+    typedef value_type* iterator;
+    typedef const value_type* const_iterator;
+
+private:
+    value_type* elements;
+    size_type count;
+
+    static value_type* allocateElements(size_type n) {
+        if (n == 0) {
+            return nullptr;
+        }
+        return static_cast<value_type*>(::operator new(n * sizeof(value_type), std::align_val_t(alignof(value_type))));
+    }
+
+    static void freeElements(value_type* p) {
+        if (p != nullptr) {
+            ::operator delete(p, std::align_val_t(alignof(value_type)));
+        }
+    }
+
+public:
+    /*!
+     * Builds an array from the next n elements of first, which only has
+     * to be an input iterator
+     */
+    template <typename InputIt>
+    MaybeArray(InputIt first, size_type n) : Payloads(n, sizeof(T)), elements(allocateElements(n)), count(n) {
+#if MAYBE_EXCEPTIONS
+        try {
+            Payloads::construct(first, n, elements);
+        } catch (...) {
+            freeElements(elements);
+            throw;
+        }
+#else
+        Payloads::construct(first, n, elements);
+#endif
+    }
+
+    MaybeArray(MaybeArray&& other) noexcept
+        : Payloads(std::move(other)), elements(other.elements), count(other.count) {
+        other.elements = nullptr;
+        other.count = 0;
+    }
+
+    MaybeArray& operator=(MaybeArray&& other) noexcept {
+        if (this != &other) {
+            maybe_destroy_n(elements, count);
+            freeElements(elements);
+            Payloads::operator=(std::move(other));
+            elements = other.elements;
+            count = other.count;
+            other.elements = nullptr;
+            other.count = 0;
+        }
+        return *this;
+    }
+
+    MaybeArray(const MaybeArray&) = delete;
+    MaybeArray& operator=(const MaybeArray&) = delete;
+
+    ~MaybeArray() {
+        maybe_destroy_n(elements, count);
+        freeElements(elements);
+    }
+
+    size_type size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    value_type& operator[](size_type i) {
+        return elements[i];
+    }
+
+    const value_type& operator[](size_type i) const {
+        return elements[i];
+    }
+
+    value_type* data() {
+        return elements;
+    }
+
+    const value_type* data() const {
+        return elements;
+    }
+
+    iterator begin() { return elements; }
+    iterator end() { return elements + count; }
+    const_iterator begin() const { return elements; }
+    const_iterator end() const { return elements + count; }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+};
+
+/*!
+ * Builds a MaybeArray from [first, last). The iterators must be
+ * forward iterators, since the size is needed up front; use the
+ * MaybeArray(first, n) constructor for single pass input.
+ */
+template <typename T, typename Policy = MaybeInline, typename ForwardIt>
+MaybeArray<T, Policy> make_maybe_array(ForwardIt first, ForwardIt last) {
+    static_assert(std::is_base_of<std::forward_iterator_tag,
+                      typename std::iterator_traits<ForwardIt>::iterator_category>::value,
+                  "make_maybe_array needs forward iterators; pass a count for input iterators");
+    return MaybeArray<T, Policy>(first, static_cast<std::size_t>(std::distance(first, last)));
+}
+
+/*!
+ * Builds a MaybeArray from a whole range
+ */
+template <typename T, typename Policy = MaybeInline, typename Range>
+MaybeArray<T, Policy> make_maybe_array(const Range& range) {
+    using std::begin;
+    using std::end;
+    return make_maybe_array<T, Policy>(begin(range), end(range));
+}
+
+#endif
@@ -0,0 +1,333 @@
+#ifndef MAYBE_CACHE_H
+#define MAYBE_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "Maybe.h"
+#include "MaybeHazard.h"
+
+/*!
+ * A concurrent cache from K to Maybe<V>, for read-mostly lookups shared
+ * between threads. A stored empty Maybe means the key is known to have
+ * no value, so misses are cached as well as hits and the backend is not
+ * asked again for keys it doesn't have.
+ *
+ *     MaybeCache<UserId, Profile> profiles;
+ *
+ *     auto h = profiles.get_or_load(id, [&](const UserId& id) {
+ *         return backend.fetchProfile(id);   //returns Maybe<Profile>
+ *     });
+ *     if (Maybe<const Profile&> p = h.value()) {
+ *         render(p());
+ *     }
+ *
+ * Keys are spread over shards, each one a hash table whose buckets are
+ * immutable once published. Readers never lock: a lookup protects the
+ * table and bucket it reads with hazard pointers, and returns a Handle
+ * which keeps them pinned, so the value it refers to stays valid and is
+ * never copied. Writers lock their shard, build a replacement bucket
+ * (copying the few entries that share it), publish it, and retire the
+ * old one, which is freed once no Handle can see it.
+ *
+ * Entries are never evicted; use erase() or clear() to drop them.
+ */
+template <typename K, typename V, typename Hash = std::hash<K>, typename KeyEqual = std::equal_to<K> >
+class MaybeCache {
+
+    struct Entry {
+        K key;
+        Maybe<V> value;
+    };
+
+    struct Chain {
+        std::vector<Entry> entries;
+    };
+
+    /*!
+     * One shard's buckets. The chains hanging off it are owned by it
+     * until they are replaced.
+     */
+    struct Table {
+        std::size_t mask;
+        std::unique_ptr<std::atomic<Chain*>[]> buckets;
+
+        explicit Table(std::size_t n) : mask(n - 1), buckets(new std::atomic<Chain*>[n]) {
+            for (std::size_t i = 0; i < n; ++i) {
+                buckets[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        ~Table() {
+            for (std::size_t i = 0; i <= mask; ++i) {
+                delete buckets[i].load(std::memory_order_relaxed);
+            }
+        }
+    };
+
+    struct alignas(64) Shard {
+        std::mutex lock;
+        std::atomic<Table*> table;
+        std::atomic<std::size_t> count;
+
+        Shard() : table(new Table(initialBuckets)), count(0) {}
+
+        ~Shard() {
+            delete table.load(std::memory_order_relaxed);
+        }
+    };
+
+    static constexpr std::size_t initialBuckets = 16;
+
+    std::unique_ptr<Shard[]> shards;
+    std::size_t shardMask;
+    unsigned shardBits;
+    Hash hasher;
+    KeyEqual equal;
+
+    Shard& shardFor(std::size_t h) const {
+        return shards[h & shardMask];
+    }
+
+    std::size_t bucketFor(std::size_t h, const Table* t) const {
+        return (h >> shardBits) & t->mask;
+    }
+
+    /*!
+     * Doubles the shard's buckets once it averages more than two
+     * entries per bucket. Must be called with the shard locked.
+     */
+    void maybeGrow(Shard& s, Table* t) {
+        if (s.count.load(std::memory_order_relaxed) <= 2 * (t->mask + 1)) {
+            return;
+        }
+
+        Table* bigger = new Table(2 * (t->mask + 1));
+        for (std::size_t i = 0; i <= t->mask; ++i) {
+            Chain* c = t->buckets[i].load(std::memory_order_relaxed);
+            if (c == nullptr) {
+                continue;
+            }
+            for (const Entry& e : c->entries) {
+                std::atomic<Chain*>& slot = bigger->buckets[bucketFor(hasher(e.key), bigger)];
+                Chain* dest = slot.load(std::memory_order_relaxed);
+                if (dest == nullptr) {
+                    dest = new Chain();
+                    slot.store(dest, std::memory_order_relaxed);
+                }
+                dest->entries.push_back(e);
+            }
+        }
+
+        s.table.store(bigger);
+        Maybe_Detail::HazardDomain::instance().retire(t);
+    }
+
+    /*!
+     * Replaces key's entry in its bucket. With no value, just drops it.
+     */
+    void replace(const K& key, Maybe<Maybe<V> > value) {
+        std::size_t h = hasher(key);
+        Shard& s = shardFor(h);
+        std::lock_guard<std::mutex> guard(s.lock);
+
+        Table* t = s.table.load(std::memory_order_relaxed);
+        std::atomic<Chain*>& slot = t->buckets[bucketFor(h, t)];
+        Chain* old = slot.load(std::memory_order_relaxed);
+
+        Chain* next = new Chain();
+        bool existed = false;
+        if (old != nullptr) {
+            next->entries.reserve(old->entries.size() + 1);
+            for (const Entry& e : old->entries) {
+                if (equal(e.key, key)) {
+                    existed = true;
+                } else {
+                    next->entries.push_back(e);
+                }
+            }
+        }
+        if (value) {
+            next->entries.push_back(Entry{key, std::move(*value)});
+        }
+
+        if (next->entries.empty()) {
+            delete next;
+            next = nullptr;
+        }
+        if (next == nullptr && old == nullptr) {
+            return;
+        }
+
+        slot.store(next);
+        Maybe_Detail::HazardDomain::instance().retire(old);
+
+        if (value && !existed) {
+            s.count.fetch_add(1, std::memory_order_relaxed);
+            maybeGrow(s, t);
+        } else if (!value && existed) {
+            s.count.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    /*!
+     * The result of a lookup. While it lives, the entry it found stays
+     * in memory, even if it is replaced or erased from the cache in the
+     * meantime.
+     */
+    class Handle {
+
+        friend class MaybeCache;
+
+        Maybe_Detail::HazardGuard tableGuard;
+        Maybe_Detail::HazardGuard chainGuard;
+        const Entry* entry;
+
+        Handle() : entry(nullptr) {}
+
+    public:
+        /*!
+         * Moves the protection and the entry over, leaving other empty so
+         * it can't reach an entry it no longer protects
+         */
+        Handle(Handle&& other) noexcept
+            : tableGuard(std::move(other.tableGuard)), chainGuard(std::move(other.chainGuard)), entry(other.entry) {
+            other.entry = nullptr;
+        }
+
+        Handle& operator=(Handle&& other) noexcept {
+            if (this != &other) {
+                tableGuard = std::move(other.tableGuard);
+                chainGuard = std::move(other.chainGuard);
+                entry = other.entry;
+                other.entry = nullptr;
+            }
+            return *this;
+        }
+
+        /*!
+         * Checks if the cache had an entry for the key, either a value or
+         * a known absence
+         */
+        bool cached() const {
+            return entry != nullptr;
+        }
+
+        /*!
+         * Checks if the key is cached as having no value
+         */
+        bool absent() const {
+            return entry != nullptr && !entry->value;
+        }
+
+        /*!
+         * The cached value, or an empty Maybe if there isn't one. It
+         * refers into the cache, and is only valid while the handle is.
+         */
+        Maybe<const V&> value() const {
+            return entry != nullptr && entry->value ? Maybe<const V&>(*entry->value) : Maybe<const V&>();
+        }
+    };
+
+    /*!
+     * Creates an empty cache with the given number of shards, rounded up
+     * to a power of two
+     */
+    explicit MaybeCache(std::size_t shardCount = 16, const Hash& hash = Hash(), const KeyEqual& eq = KeyEqual())
+        : shardMask(0), shardBits(0), hasher(hash), equal(eq) {
+        while ((std::size_t(1) << shardBits) < shardCount) {
+            ++shardBits;
+        }
+        shards.reset(new Shard[std::size_t(1) << shardBits]);
+        shardMask = (std::size_t(1) << shardBits) - 1;
+    }
+
+    MaybeCache(const MaybeCache&) = delete;
+    MaybeCache& operator=(const MaybeCache&) = delete;
+
+    /*!
+     * Looks key up without blocking
+     */
+    Handle find(const K& key) const {
+        std::size_t h = hasher(key);
+        Shard& s = shardFor(h);
+
+        Handle out;
+        Table* t = out.tableGuard.protect(s.table);
+        Chain* c = out.chainGuard.protect(t->buckets[bucketFor(h, t)]);
+        if (c != nullptr) {
+            for (const Entry& e : c->entries) {
+                if (equal(e.key, key)) {
+                    out.entry = &e;
+                    break;
+                }
+            }
+        }
+        return out;
+    }
+
+    /*!
+     * Stores value for key, replacing whatever was there. An empty value
+     * marks the key as known to have none.
+     */
+    void insert_or_assign(const K& key, Maybe<V> value) {
+        replace(key, Maybe<Maybe<V> >(std::in_place, std::move(value)));
+    }
+
+    /*!
+     * Looks key up, and on a miss stores and returns whatever
+     * loader(key) gives, which may be an empty Maybe. The loader runs
+     * without any lock held, so two threads missing on the same key at
+     * once may both call it.
+     */
+    template <typename F>
+    Handle get_or_load(const K& key, F&& loader) {
+        Handle h = find(key);
+        if (h.cached()) {
+            return h;
+        }
+        insert_or_assign(key, std::forward<F>(loader)(key));
+        return find(key);
+    }
+
+    /*!
+     * Forgets key, whether it had a value or was known to have none
+     */
+    void erase(const K& key) {
+        replace(key, Maybe<Maybe<V> >());
+    }
+
+    /*!
+     * Forgets everything
+     */
+    void clear() {
+        for (std::size_t i = 0; i <= shardMask; ++i) {
+            Shard& s = shards[i];
+            std::lock_guard<std::mutex> guard(s.lock);
+            Table* old = s.table.load(std::memory_order_relaxed);
+            s.table.store(new Table(initialBuckets));
+            s.count.store(0, std::memory_order_relaxed);
+            Maybe_Detail::HazardDomain::instance().retire(old);
+        }
+    }
+
+    /*!
+     * The number of cached keys, including known absences. Only
+     * approximate while writers are running.
+     */
+    std::size_t size() const {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i <= shardMask; ++i) {
+            n += shards[i].count.load(std::memory_order_relaxed);
+        }
+        return n;
+    }
+};
+
+#endif
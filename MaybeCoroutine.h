@@ -0,0 +1,364 @@
+#ifndef MAYBE_COROUTINE_H
+#define MAYBE_COROUTINE_H
+
+// Coroutines need C++20; before that this header provides nothing.
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <coroutine>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "Expected.h"
+#include "Maybe.h"
+
+/*
+ * Lets a function returning a Maybe or an Expected be written as a
+ * coroutine, where co_await unwraps a Maybe or Expected or, if it has no
+ * value, stops the coroutine there and returns empty (or the error):
+ *
+ *     Maybe<Session> lookupSession(const Request& r) {
+ *         UserId id = co_await parseUser(r);          //Maybe<UserId>
+ *         Account& account = co_await findAccount(id); //Maybe<Account&>
+ *         co_return Session(account, r.time);
+ *     }
+ *
+ *     Expected<Port, ParseError> readPort(const Config& c) {
+ *         std::string text = co_await c.lookup("port"); //Expected<std::string, ParseError>
+ *         co_return co_await parsePort(text);
+ *     }
+ *
+ * The body runs straight through on the calling thread: these are a
+ * shorthand for the `if (!m) return nullptr;` chain, not a way to
+ * suspend, so only Maybes, Maybe proxies and Expecteds can be awaited in
+ * them. An Expected coroutine can't await a Maybe, since there would be
+ * no error to return; convert it with Expected(maybe, error) first. A
+ * Maybe coroutine awaiting an Expected drops the error.
+ *
+ * Coroutine frames come from the global heap, unless the coroutine
+ * takes std::allocator_arg and an allocator as its first parameters
+ * (after the object, for member functions), in which case they come from
+ * that allocator:
+ *
+ *     Maybe<Row> decode(std::allocator_arg_t, MaybeArenaAllocator<char> a, const Msg& m);
+ *
+ * This relies on the compiler converting the coroutine's return object
+ * once the body has finished running, as GCC and Clang do.
+ */
+
+#if !defined(__GNUC__) && !defined(__clang__)
+#error "MaybeCoroutine.h needs the return object converted after the coroutine body has run, which only GCC and Clang are known to do"
+#endif
+
+namespace Maybe_Detail
+{
+  /*!
+   * The allocation functions of Maybe and Expected coroutine frames which
+   * come from the global heap, and the machinery shared with those which
+   * come from an allocator. Each frame is followed by a trailer holding
+   * the function which frees it and, when it came from an allocator, a
+   * copy of that allocator, so operator delete can hand the frame back to
+   * wherever it came from.
+   */
+  class CoroutineFrames {
+
+      typedef void (*Free)(void* frame, std::size_t size);
+
+      template <typename A>
+      struct Trailer {
+          Free free;
+          A alloc;
+      };
+
+      static constexpr std::size_t unit = sizeof(std::max_align_t);
+
+      static std::size_t trailerOffset(std::size_t size) {
+          return (size + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+      }
+
+      template <typename A>
+      static std::size_t units(std::size_t size) {
+          return (trailerOffset(size) + sizeof(Trailer<A>) + unit - 1) / unit;
+      }
+
+      template <typename A>
+      static Trailer<A>* trailer(void* frame, std::size_t size) {
+          return reinterpret_cast<Trailer<A>*>(static_cast<char*>(frame) + trailerOffset(size));
+      }
+
+      template <typename A>
+      static void freeWith(void* frame, std::size_t size) {
+          typedef std::allocator_traits<A> Traits;
+
+          Trailer<A>* t = trailer<A>(frame, size);
+          A alloc(std::move(t->alloc));
+          t->~Trailer<A>();
+          Traits::deallocate(alloc, static_cast<std::max_align_t*>(frame), units<A>(size));
+      }
+
+  protected:
+      template <typename Alloc>
+      static void* allocateWith(std::size_t size, const Alloc& a) {
+          typedef typename std::allocator_traits<Alloc>::template rebind_alloc<std::max_align_t> A;
+          typedef std::allocator_traits<A> Traits;
+          static_assert(alignof(Trailer<A>) <= alignof(std::max_align_t), "frame allocators must not be over-aligned");
+
+          A alloc(a);
+          void* frame = Traits::allocate(alloc, units<A>(size));
+          ::new (static_cast<void*>(trailer<A>(frame, size))) Trailer<A>{&freeWith<A>, std::move(alloc)};
+          return frame;
+      }
+
+      static void release(void* frame, std::size_t size) {
+          (*reinterpret_cast<Free*>(static_cast<char*>(frame) + trailerOffset(size)))(frame, size);
+      }
+
+  public:
+      static void* operator new(std::size_t size) {
+          return allocateWith(size, std::allocator<std::max_align_t>());
+      }
+
+      static void operator delete(void* frame, std::size_t size) {
+          release(frame, size);
+      }
+  };
+
+  /*!
+   * The frames of a coroutine whose parameters are std::allocator_arg, an
+   * Alloc and then Rest, which come from a copy of that allocator.
+   *
+   * The parameter types are the class's rather than operator new's own,
+   * and operator delete is declared alongside it: GCC warns of a
+   * mismatched delete at every call of the coroutine when a templated
+   * operator new is paired with a plain operator delete, or with one from
+   * another class.
+   */
+  template <typename Alloc, typename... Rest>
+  class AllocatorFrames : public CoroutineFrames {
+
+  public:
+      static void* operator new(std::size_t size, std::allocator_arg_t, const Alloc& a, const Rest&...) {
+          return allocateWith(size, a);
+      }
+
+      static void operator delete(void* frame, std::size_t size) {
+          release(frame, size);
+      }
+
+      static void operator delete(void* frame, std::size_t size, std::allocator_arg_t, const Alloc&, const Rest&...) {
+          release(frame, size);
+      }
+  };
+
+  /*!
+   * The same for a member function, whose object comes first
+   */
+  template <typename Self, typename Alloc, typename... Rest>
+  class MemberAllocatorFrames : public CoroutineFrames {
+
+  public:
+      static void* operator new(std::size_t size, const Self&, std::allocator_arg_t, const Alloc& a, const Rest&...) {
+          return allocateWith(size, a);
+      }
+
+      static void operator delete(void* frame, std::size_t size) {
+          release(frame, size);
+      }
+
+      static void operator delete(void* frame, std::size_t size, const Self&, std::allocator_arg_t, const Alloc&, const Rest&...) {
+          release(frame, size);
+      }
+  };
+
+  /*!
+   * Which of the above allocates the frames of a coroutine taking Params,
+   * decayed, as coroutine_traits sees them
+   */
+  template <typename... Params>
+  struct CoroutineFramesFor {
+      typedef CoroutineFrames type;
+  };
+
+  template <typename Alloc, typename... Rest>
+  struct CoroutineFramesFor<std::allocator_arg_t, Alloc, Rest...> {
+      typedef AllocatorFrames<Alloc, Rest...> type;
+  };
+
+  template <typename Self, typename Alloc, typename... Rest>
+  struct CoroutineFramesFor<Self, std::allocator_arg_t, Alloc, Rest...> {
+      typedef MemberAllocatorFrames<Self, Alloc, Rest...> type;
+  };
+
+  /*!
+   * What a Maybe or Expected coroutine hands back to its caller. The
+   * promise writes the result straight into it, and it turns into the
+   * coroutine's return type once the body is done. It is never copied or
+   * moved, so the promise's pointer to it stays good.
+   */
+  template <typename R>
+  class CoroutineReturn {
+
+      Maybe<R> result;
+
+  public:
+      explicit CoroutineReturn(Maybe<R>*& slot) {
+          slot = &result;
+      }
+
+      CoroutineReturn(const CoroutineReturn&) = delete;
+      CoroutineReturn& operator=(const CoroutineReturn&) = delete;
+
+      operator R() {
+          return result ? std::move(*result) : R();
+      }
+  };
+
+  template <typename R, typename Frames>
+  class CoroutinePromise;
+
+  /*!
+   * Awaits a Maybe, or a Maybe proxy: gives its value, or stops the
+   * coroutine if it has none
+   */
+  template <typename M>
+  class MaybeAwaiter {
+
+      M& m;
+
+  public:
+      explicit MaybeAwaiter(M& m) : m(m) {}
+
+      bool await_ready() const {
+          return static_cast<bool>(m);
+      }
+
+      template <typename R, typename Frames>
+      void await_suspend(std::coroutine_handle<CoroutinePromise<R, Frames> > h) {
+          h.destroy();
+      }
+
+      /*!
+       * The value, by reference when awaiting an lvalue or a Maybe of a
+       * reference, and moved out when awaiting a temporary
+       */
+      decltype(auto) await_resume() {
+          typedef decltype(*std::forward<M>(m)) Ref;
+          if constexpr (std::is_lvalue_reference<Ref>::value) {
+              return *std::forward<M>(m);
+          } else {
+              return typename std::decay<Ref>::type(*std::forward<M>(m));
+          }
+      }
+  };
+
+  /*!
+   * Awaits an Expected: gives its value, or stops the coroutine, passing
+   * the error on if the coroutine returns an Expected too
+   */
+  template <typename X>
+  class ExpectedAwaiter {
+
+      X& x;
+
+  public:
+      explicit ExpectedAwaiter(X& x) : x(x) {}
+
+      bool await_ready() const {
+          return x.has_value();
+      }
+
+      template <typename R, typename Frames>
+      void await_suspend(std::coroutine_handle<CoroutinePromise<R, Frames> > h) {
+          if constexpr (IsExpected<R>::value) {
+              h.promise().fail(Unexpected<typename std::decay<decltype(x.error())>::type>(std::forward<X>(x).error()));
+          }
+          h.destroy();
+      }
+
+      decltype(auto) await_resume() {
+          typedef decltype(*std::forward<X>(x)) Ref;
+          if constexpr (std::is_lvalue_reference<Ref>::value) {
+              return *std::forward<X>(x);
+          } else {
+              return typename std::decay<Ref>::type(*std::forward<X>(x));
+          }
+      }
+  };
+
+  /*!
+   * The promise of a coroutine returning R, a Maybe or an Expected. It
+   * never suspends, so the body runs to its end, or to the first awaited
+   * empty Maybe or error, before the coroutine returns. Its frame is
+   * allocated by Frames.
+   */
+  template <typename R, typename Frames>
+  class CoroutinePromise : public Frames {
+
+      Maybe<R>* result;
+
+  public:
+      CoroutineReturn<R> get_return_object() {
+          return CoroutineReturn<R>(result);
+      }
+
+      std::suspend_never initial_suspend() noexcept { return {}; }
+      std::suspend_never final_suspend() noexcept { return {}; }
+
+      void unhandled_exception() {
+#if MAYBE_EXCEPTIONS
+          throw;
+#endif
+      }
+
+      /*!
+       * co_return takes anything R can be built from: a value, nullptr
+       * or another Maybe for a Maybe, a value or Unexpected for an
+       * Expected
+       */
+      template <typename U>
+      void return_value(U&& u) {
+          result->emplace(std::forward<U>(u));
+      }
+
+      /*!
+       * Ends an Expected coroutine with the error of an awaited Expected
+       */
+      template <typename U>
+      void fail(U&& u) {
+          result->emplace(std::forward<U>(u));
+      }
+
+      template <typename A>
+      auto await_transform(A&& a) {
+          typedef typename std::decay<A>::type D;
+
+          if constexpr (IsExpected<D>::value) {
+              return ExpectedAwaiter<A&&>(a);
+          } else {
+              static_assert(IsMaybe<D>::value || IsMaybeProxy<D>::value,
+                            "Maybe and Expected coroutines can only await Maybes and Expecteds");
+              static_assert(!IsExpected<R>::value,
+                            "an Expected coroutine can't await a Maybe, since it has no error to return");
+              return MaybeAwaiter<A&&>(a);
+          }
+      }
+  };
+}
+
+template <typename T, typename Policy, typename... Args>
+struct std::coroutine_traits<Maybe<T, Policy>, Args...> {
+    typedef Maybe_Detail::CoroutinePromise<Maybe<T, Policy>,
+        typename Maybe_Detail::CoroutineFramesFor<typename std::decay<Args>::type...>::type> promise_type;
+};
+
+template <typename T, typename E, typename... Args>
+struct std::coroutine_traits<Expected<T, E>, Args...> {
+    typedef Maybe_Detail::CoroutinePromise<Expected<T, E>,
+        typename Maybe_Detail::CoroutineFramesFor<typename std::decay<Args>::type...>::type> promise_type;
+};
+
+#endif
+
+#endif
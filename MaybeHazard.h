@@ -0,0 +1,265 @@
+#ifndef MAYBE_HAZARD_H
+#define MAYBE_HAZARD_H
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/*
+ * Hazard pointers, used to free memory that lock-free readers might
+ * still be looking at. A reader publishes the pointer it is about to
+ * dereference in a hazard record, then checks that the pointer is still
+ * current. A writer which unlinks an object retires it, and retired
+ * objects are only freed once no record holds them.
+ *
+ * There is a single process-wide set of records. Records are never
+ * freed, only recycled, so a scan can walk them without any locking.
+ */
+namespace Maybe_Detail
+{
+  struct HazardRecord {
+      std::atomic<const void*> ptr;
+      std::atomic<bool> active;
+      HazardRecord* next;
+
+      HazardRecord() : ptr(nullptr), active(true), next(nullptr) {}
+  };
+
+  class HazardDomain {
+
+      struct Retired {
+          void* p;
+          void (*deleter)(void*);
+      };
+
+      /*!
+       * Objects retired by one thread. Whatever is still protected when
+       * the thread exits is handed over to the domain's orphan list,
+       * and each exiting thread also frees whatever orphans it can, so
+       * nothing is left behind once the last thread is gone.
+       */
+      struct RetireList {
+          std::vector<Retired> items;
+
+          ~RetireList() {
+              HazardDomain& domain = HazardDomain::instance();
+
+              // freeing an item can retire more into this list, so keep
+              // going until a pass retires nothing new
+              do {
+                  domain.reclaim(items);
+                  domain.addOrphans(items);
+                  domain.reclaimOrphans(true);
+              } while (!items.empty());
+          }
+      };
+
+      std::atomic<HazardRecord*> head;
+      std::atomic<std::size_t> recordCount;
+
+      std::mutex orphanLock;
+      std::vector<Retired> orphans;
+
+      HazardDomain() : head(nullptr), recordCount(0) {}
+
+      static RetireList& retireList() {
+          static thread_local RetireList list;
+          return list;
+      }
+
+      /*!
+       * Frees every item in items which no hazard record is protecting,
+       * and leaves the rest in place.
+       *
+       * A deleter may retire more objects, which can land in items
+       * itself, so the scan runs over a copy taken out of it first and
+       * whatever survives is appended back afterwards.
+       */
+      void reclaim(std::vector<Retired>& items) {
+          std::vector<Retired> scanning;
+          scanning.swap(items);
+
+          std::vector<const void*> protectedPtrs;
+          for (HazardRecord* r = head.load(); r != nullptr; r = r->next) {
+              const void* p = r->ptr.load();
+              if (p != nullptr) {
+                  protectedPtrs.push_back(p);
+              }
+          }
+
+          std::size_t kept = 0;
+          for (std::size_t i = 0; i < scanning.size(); ++i) {
+              bool isProtected = false;
+              for (const void* p : protectedPtrs) {
+                  if (p == scanning[i].p) {
+                      isProtected = true;
+                      break;
+                  }
+              }
+              if (isProtected) {
+                  scanning[kept++] = scanning[i];
+              } else {
+                  scanning[i].deleter(scanning[i].p);
+              }
+          }
+          items.insert(items.end(), scanning.begin(), scanning.begin() + kept);
+      }
+
+      /*!
+       * Hands items over to the orphan list, leaving items empty
+       */
+      void addOrphans(std::vector<Retired>& items) {
+          if (items.empty()) {
+              return;
+          }
+          std::lock_guard<std::mutex> lock(orphanLock);
+          orphans.insert(orphans.end(), items.begin(), items.end());
+          items.clear();
+      }
+
+      /*!
+       * Frees whatever orphans are no longer protected. They are taken
+       * off the list first, so their deleters run without orphanLock
+       * held and can retire more objects themselves. Unless wait is
+       * true, it gives up straight away if another thread holds the
+       * lock.
+       */
+      void reclaimOrphans(bool wait) {
+          std::vector<Retired> pending;
+          {
+              std::unique_lock<std::mutex> lock(orphanLock, std::defer_lock);
+              if (wait) {
+                  lock.lock();
+              } else if (!lock.try_lock()) {
+                  return;
+              }
+              pending.swap(orphans);
+          }
+
+          if (!pending.empty()) {
+              reclaim(pending);
+              addOrphans(pending);
+          }
+      }
+
+  public:
+      HazardDomain(const HazardDomain&) = delete;
+      HazardDomain& operator=(const HazardDomain&) = delete;
+
+      static HazardDomain& instance() {
+          static HazardDomain domain;
+          return domain;
+      }
+
+      /*!
+       * Claims a free record, making a new one if they are all in use
+       */
+      HazardRecord* acquire() {
+          for (HazardRecord* r = head.load(); r != nullptr; r = r->next) {
+              bool expected = false;
+              if (!r->active.load(std::memory_order_relaxed) && r->active.compare_exchange_strong(expected, true)) {
+                  return r;
+              }
+          }
+
+          HazardRecord* r = new HazardRecord();
+          HazardRecord* old = head.load();
+          do {
+              r->next = old;
+          } while (!head.compare_exchange_weak(old, r));
+          recordCount.fetch_add(1);
+          return r;
+      }
+
+      void release(HazardRecord* r) {
+          r->ptr.store(nullptr);
+          r->active.store(false, std::memory_order_release);
+      }
+
+      /*!
+       * Checks if any record is currently protecting p
+       */
+      bool isProtected(const void* p) {
+          for (HazardRecord* r = head.load(); r != nullptr; r = r->next) {
+              if (r->ptr.load() == p) {
+                  return true;
+              }
+          }
+          return false;
+      }
+
+      /*!
+       * Hands p over to be deleted once no reader is protecting it. p
+       * must already be unreachable for new readers.
+       */
+      template <typename T>
+      void retire(T* p) {
+          if (p == nullptr) {
+              return;
+          }
+
+          RetireList& list = retireList();
+          list.items.push_back(Retired{p, [](void* q) { delete static_cast<T*>(q); }});
+
+          if (list.items.size() >= 2 * recordCount.load(std::memory_order_relaxed) + 16) {
+              reclaim(list.items);
+              reclaimOrphans(false);
+          }
+      }
+  };
+
+  /*!
+   * Owns one hazard record for as long as it lives
+   */
+  class HazardGuard {
+
+      HazardRecord* record;
+
+  public:
+      HazardGuard() : record(HazardDomain::instance().acquire()) {}
+
+      HazardGuard(HazardGuard&& other) noexcept : record(other.record) {
+          other.record = nullptr;
+      }
+
+      HazardGuard& operator=(HazardGuard&& other) noexcept {
+          std::swap(record, other.record);
+          return *this;
+      }
+
+      HazardGuard(const HazardGuard&) = delete;
+      HazardGuard& operator=(const HazardGuard&) = delete;
+
+      ~HazardGuard() {
+          if (record != nullptr) {
+              HazardDomain::instance().release(record);
+          }
+      }
+
+      /*!
+       * Loads src and protects the result, retrying until the protected
+       * pointer is still the one in src. The result stays safe to
+       * dereference until the guard protects something else or goes away.
+       */
+      template <typename T>
+      T* protect(const std::atomic<T*>& src) {
+          T* p = src.load();
+          for (;;) {
+              record->ptr.store(p);
+              T* again = src.load();
+              if (again == p) {
+                  return p;
+              }
+              p = again;
+          }
+      }
+
+      void reset() {
+          record->ptr.store(nullptr);
+      }
+  };
+}
+
+#endif
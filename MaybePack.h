@@ -0,0 +1,406 @@
+#ifndef MAYBE_PACK_H
+#define MAYBE_PACK_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "Maybe.h"
+
+namespace Maybe_Detail
+{
+  /*!
+   * The smallest unsigned type with a bit for each of n fields
+   */
+  template <std::size_t n>
+  using PackWord = typename std::conditional<n <= 8, std::uint8_t,
+                   typename std::conditional<n <= 16, std::uint16_t,
+                   typename std::conditional<n <= 32, std::uint32_t, std::uint64_t>::type>::type>::type;
+
+  /*!
+   * Where each field of a MaybePack lives in its payload bytes. Fields
+   * are placed from the most aligned down to the least, which leaves no
+   * padding between them since every size is a multiple of its
+   * alignment.
+   */
+  template <typename... Ts>
+  struct PackLayout {
+      static constexpr std::size_t count = sizeof...(Ts);
+
+      struct Offsets {
+          std::size_t at[count];
+          std::size_t size;
+          std::size_t align;
+      };
+
+      static constexpr Offsets compute() {
+          const std::size_t sizes[] = {sizeof(Ts)...};
+          const std::size_t aligns[] = {alignof(Ts)...};
+
+          Offsets o{};
+          bool placed[count] = {};
+          o.align = 1;
+          for (std::size_t n = 0; n < count; ++n) {
+              std::size_t best = count;
+              for (std::size_t i = 0; i < count; ++i) {
+                  if (!placed[i] && (best == count || aligns[i] > aligns[best])) {
+                      best = i;
+                  }
+              }
+              placed[best] = true;
+              o.at[best] = o.size;
+              o.size += sizes[best];
+              o.align = aligns[best] > o.align ? aligns[best] : o.align;
+          }
+          return o;
+      }
+
+      static constexpr Offsets offsets = compute();
+  };
+}
+
+/*!
+ * A fixed set of optional fields, like a struct of Maybe<Ts>... but
+ * smaller: whether each field has a value is one bit of a single word,
+ * and the values are packed together with no padding between them.
+ *
+ *     //12 bytes, where the three Maybes would take 20
+ *     MaybePack<std::int32_t, float, std::uint16_t> sample;
+ *
+ *     sample.get<0>() = 42;
+ *     if (sample.get<1>()) {
+ *         //will not get here, field 1 has no value
+ *     }
+ *     Maybe<float> temp = sample.get<1>();
+ *
+ *     if (sample.all()) {
+ *         //every field is set
+ *     }
+ *
+ * get<I>() hands out a proxy which behaves like a Maybe<T>&, as
+ * MaybeVector's elements do, and so does maybe_get<I>(sample). Fields
+ * must be trivially copyable, so the pack is too. A field without a value
+ * has its bytes zeroed.
+ */
+template <typename... Ts>
+class MaybePack {
+
+    static_assert(sizeof...(Ts) > 0, "MaybePack needs at least one field");
+    static_assert(sizeof...(Ts) <= 64, "MaybePack fields have to fit in a 64 bit word");
+    static_assert((std::is_trivially_copyable<Ts>::value && ...), "MaybePack fields must be trivially copyable");
+
+    typedef Maybe_Detail::PackLayout<Ts...> Layout;
+
+public:
+    typedef Maybe_Detail::PackWord<sizeof...(Ts)> word_type;
+
+    template <std::size_t I>
+    using element_type = typename std::tuple_element<I, std::tuple<Ts...> >::type;
+
+    static constexpr std::size_t count = sizeof...(Ts);
+
+    template <std::size_t I, bool Const>
+    class Ref;
+
+private:
+    static constexpr word_type fullMask =
+        count == 64 ? word_type(~word_type(0)) : word_type((std::uint64_t(1) << count) - 1);
+
+    alignas(Layout::offsets.align) unsigned char payload[Layout::offsets.size];
+    word_type bits;
+
+    template <std::size_t I>
+    static constexpr word_type bit() {
+        return word_type(word_type(1) << I);
+    }
+
+    template <std::size_t I>
+    element_type<I>* slot() {
+        return std::launder(reinterpret_cast<element_type<I>*>(payload + Layout::offsets.at[I]));
+    }
+
+    template <std::size_t I>
+    const element_type<I>* slot() const {
+        return std::launder(reinterpret_cast<const element_type<I>*>(payload + Layout::offsets.at[I]));
+    }
+
+    /*!
+     * Stores a value in field I, replacing whatever was there
+     */
+    template <std::size_t I, typename... Args>
+    void setField(Args&&... args) {
+        ::new (static_cast<void*>(payload + Layout::offsets.at[I])) element_type<I>(std::forward<Args>(args)...);
+        bits |= bit<I>();
+    }
+
+    template <std::size_t I>
+    void clearField() {
+        bits &= word_type(~bit<I>());
+        for (std::size_t i = 0; i < sizeof(element_type<I>); ++i) {
+            payload[Layout::offsets.at[I] + i] = 0;
+        }
+    }
+
+    /*!
+     * Sets field I from anything a Maybe<element_type<I>> can be made of
+     */
+    template <std::size_t I, typename A>
+    void assignField(A&& a) {
+        typedef typename std::decay<A>::type D;
+
+        if constexpr (Maybe_Detail::IsMaybe<D>::value || Maybe_Detail::IsMaybeProxy<D>::value) {
+            if (a) {
+                setField<I>(*a);
+            } else {
+                clearField<I>();
+            }
+        } else if constexpr (std::is_same<D, std::nullptr_t>::value) {
+            clearField<I>();
+        } else {
+            setField<I>(std::forward<A>(a));
+        }
+    }
+
+    template <std::size_t... Is, typename... As>
+    void assignFields(std::index_sequence<Is...>, As&&... as) {
+        (assignField<Is>(std::forward<As>(as)), ...);
+    }
+
+    template <std::size_t... Is>
+    bool equalFields(const MaybePack& other, std::index_sequence<Is...>) const {
+        return ((!(bits & bit<Is>()) || Maybe_Detail::doEqualComparison(*slot<Is>(), *other.slot<Is>())) && ...);
+    }
+
+public:
+    /*!
+     * Constructs a pack with no field set
+     */
+    MaybePack() : payload(), bits(0) {}
+
+    /*!
+     * Constructs a pack with each field set from the matching argument:
+     * a value, nullptr, or a Maybe
+     */
+    template <typename... As, typename = typename std::enable_if<
+        sizeof...(As) == count && !(sizeof...(As) == 1 && (std::is_same<typename std::decay<As>::type, MaybePack>::value || ...))>::type>
+    MaybePack(As&&... as) : payload(), bits(0) {
+        assignFields(std::index_sequence_for<Ts...>(), std::forward<As>(as)...);
+    }
+
+    /*!
+     * Field I, as a proxy standing in for a Maybe<element_type<I>>&
+     */
+    template <std::size_t I>
+    Ref<I, false> get() {
+        static_assert(I < count, "MaybePack field index out of range");
+        return Ref<I, false>(this);
+    }
+
+    template <std::size_t I>
+    Ref<I, true> get() const {
+        static_assert(I < count, "MaybePack field index out of range");
+        return Ref<I, true>(this);
+    }
+
+    template <std::size_t I>
+    bool has_value() const {
+        return (bits & bit<I>()) != 0;
+    }
+
+    /*!
+     * Checks if any field has a value
+     */
+    bool any() const {
+        return bits != 0;
+    }
+
+    /*!
+     * Checks if every field has a value
+     */
+    bool all() const {
+        return bits == fullMask;
+    }
+
+    /*!
+     * Checks if no field has a value
+     */
+    bool none() const {
+        return bits == 0;
+    }
+
+    /*!
+     * One bit per field, set for the fields with a value, field 0 in the
+     * lowest bit
+     */
+    word_type mask() const {
+        return bits;
+    }
+
+    /*!
+     * Empties every field
+     */
+    void reset() {
+        *this = MaybePack();
+    }
+
+    /*!
+     * Equal when the same fields are set and their values compare equal
+     */
+    bool operator==(const MaybePack& other) const {
+        return bits == other.bits && equalFields(other, std::index_sequence_for<Ts...>());
+    }
+
+    bool operator!=(const MaybePack& other) const {
+        return !(*this == other);
+    }
+
+    /*!
+     * A reference to one field, standing in for a Maybe<T>& (or a
+     * const Maybe<T>& when Const is true)
+     */
+    template <std::size_t I, bool Const>
+    class Ref {
+
+        friend class MaybePack;
+
+        typedef element_type<I> T;
+        typedef typename std::conditional<Const, const MaybePack, MaybePack>::type Pack;
+        typedef typename std::conditional<Const, const T, T>::type Value;
+
+        Pack* pack;
+
+        explicit Ref(Pack* pack) : pack(pack) {}
+
+    public:
+        typedef T maybe_proxy_of;
+
+        Ref(const Ref&) = default;
+
+        /*!
+         * A mutable reference can always be used as a const one
+         */
+        template <bool OtherConst, typename = typename std::enable_if<Const && !OtherConst>::type>
+        Ref(const Ref<I, OtherConst>& other) : pack(other.pack) {}
+
+        /*!
+         * Assigns the field other refers to, like assigning through a
+         * Maybe<T>&. It does not rebind this reference.
+         */
+        Ref& operator=(const Ref& other) {
+            static_assert(!Const, "cannot assign through a const MaybePack reference");
+            pack->template assignField<I>(other);
+            return *this;
+        }
+
+        /*!
+         * Assigns a value, nullptr, a Maybe or a Maybe proxy
+         */
+        template <typename O, typename = typename std::enable_if<
+            !std::is_same<typename std::decay<O>::type, Ref>::value>::type>
+        Ref& operator=(O&& other) {
+            static_assert(!Const, "cannot assign through a const MaybePack reference");
+            pack->template assignField<I>(std::forward<O>(other));
+            return *this;
+        }
+
+        /*!
+         * Checks if value can be extracted from this field
+         */
+        operator bool() const {
+            return pack->template has_value<I>();
+        }
+
+        /*!
+         * Extracts the value, and throws an exception if we can't
+         */
+        Value& operator()() const {
+            if (*this) return *pack->template slot<I>();
+            else Maybe_Detail::throwNullMaybe();
+        }
+
+        /*!
+         * Extracts the value without checking for it
+         */
+        Value& operator*() const noexcept {
+            assert(*this);
+            return *pack->template slot<I>();
+        }
+
+        Value* operator->() const noexcept {
+            assert(*this);
+            return pack->template slot<I>();
+        }
+
+        Value* get_if() const noexcept {
+            return *this ? pack->template slot<I>() : nullptr;
+        }
+
+        template <typename U>
+        T value_or(U&& def) const {
+            return *this ? *pack->template slot<I>() : static_cast<T>(std::forward<U>(def));
+        }
+
+        /*!
+         * Copies the field out into a Maybe
+         */
+        operator Maybe<T>() const {
+            return *this ? Maybe<T>(std::in_place, *pack->template slot<I>()) : Maybe<T>();
+        }
+
+        /*!
+         * Compares like Maybe::operator==, against any other Maybe proxy
+         */
+        template <typename R, typename = typename std::enable_if<Maybe_Detail::IsMaybeProxy<R>::value>::type>
+        bool operator==(const R& other) const {
+            return Maybe_Detail::equalMaybes<T, typename R::maybe_proxy_of>(*this, other);
+        }
+
+        template <typename R, typename = typename std::enable_if<Maybe_Detail::IsMaybeProxy<R>::value>::type>
+        bool operator!=(const R& other) const {
+            return !(*this == other);
+        }
+
+        template <typename oT, typename oPolicy>
+        friend bool operator==(const Ref& a, const Maybe<oT, oPolicy>& b) {
+            return Maybe_Detail::equalMaybes<T, oT>(a, b);
+        }
+
+        template <typename oT, typename oPolicy>
+        friend bool operator==(const Maybe<oT, oPolicy>& a, const Ref& b) {
+            return Maybe_Detail::equalMaybes<oT, T>(a, b);
+        }
+
+        template <typename oT, typename oPolicy>
+        friend bool operator!=(const Ref& a, const Maybe<oT, oPolicy>& b) {
+            return !(a == b);
+        }
+
+        template <typename oT, typename oPolicy>
+        friend bool operator!=(const Maybe<oT, oPolicy>& a, const Ref& b) {
+            return !(a == b);
+        }
+
+    private:
+        template <std::size_t, bool>
+        friend class Ref;
+    };
+};
+
+/*!
+ * Field I of a pack, like std::get on a tuple
+ */
+template <std::size_t I, typename... Ts>
+typename MaybePack<Ts...>::template Ref<I, false> maybe_get(MaybePack<Ts...>& pack) {
+    return pack.template get<I>();
+}
+
+template <std::size_t I, typename... Ts>
+typename MaybePack<Ts...>::template Ref<I, true> maybe_get(const MaybePack<Ts...>& pack) {
+    return pack.template get<I>();
+}
+
+#endif
@@ -0,0 +1,648 @@
+#ifndef MAYBE_PARALLEL_H
+#define MAYBE_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Maybe.h"
+#include "MaybeVector.h"
+#include "MaybeVectorOps.h"
+
+// Building with MAYBE_STD_EXECUTION=1 lets the parallel algorithms
+// below also take the standard execution policies. It is off by
+// default because with libstdc++ including <execution> means linking
+// against TBB.
+#ifndef MAYBE_STD_EXECUTION
+#define MAYBE_STD_EXECUTION 0
+#endif
+
+#if MAYBE_STD_EXECUTION
+#include <execution>
+#endif
+
+/*!
+ * A fixed set of worker threads for running loops over Maybes in
+ * parallel. A loop is cut into chunks, and every thread, including the
+ * caller, keeps claiming the next unclaimed chunk until none are left,
+ * so threads which get cheap chunks simply end up running more of them.
+ *
+ *     MaybeThreadPool pool(8);
+ *     long total = maybe_reduce(pool, column, 0L, std::plus<long>());
+ *
+ * One loop runs at a time; other threads which start one wait their
+ * turn. A loop started from inside a chunk runs on the calling thread.
+ */
+class MaybeThreadPool {
+
+    struct Job {
+        std::function<void(std::size_t)> run;
+        std::size_t chunks;
+        std::atomic<std::size_t> next;
+#if MAYBE_EXCEPTIONS
+        std::exception_ptr error;
+        std::mutex errorLock;
+#endif
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::mutex submitLock;
+    Job* job;
+    unsigned long generation;
+    unsigned active;
+    bool stopping;
+
+    static bool& inChunk() {
+        static thread_local bool inside = false;
+        return inside;
+    }
+
+    /*!
+     * Runs chunks of j until there are none left to claim. The first
+     * exception thrown is kept for the caller, and stops any further
+     * chunks from being claimed.
+     */
+    static void work(Job& j) {
+        std::size_t i;
+        while ((i = j.next.fetch_add(1, std::memory_order_relaxed)) < j.chunks) {
+#if MAYBE_EXCEPTIONS
+            try {
+                j.run(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> guard(j.errorLock);
+                if (!j.error) {
+                    j.error = std::current_exception();
+                }
+                j.next.store(j.chunks, std::memory_order_relaxed);
+            }
+#else
+            j.run(i);
+#endif
+        }
+    }
+
+    void workerLoop() {
+        inChunk() = true;
+        unsigned long seen = 0;
+        std::unique_lock<std::mutex> guard(lock);
+        for (;;) {
+            wake.wait(guard, [&] { return stopping || (job != nullptr && generation != seen); });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            Job* j = job;
+            ++active;
+            guard.unlock();
+
+            work(*j);
+
+            guard.lock();
+            if (--active == 0) {
+                idle.notify_all();
+            }
+        }
+    }
+
+public:
+    /*!
+     * Creates a pool running loops on threads threads in all, counting
+     * the one which starts the loop, so threads - 1 workers are made.
+     */
+    explicit MaybeThreadPool(unsigned threads = std::thread::hardware_concurrency())
+        : job(nullptr), generation(0), active(0), stopping(false) {
+        for (unsigned i = 1; i < threads; ++i) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    MaybeThreadPool(const MaybeThreadPool&) = delete;
+    MaybeThreadPool& operator=(const MaybeThreadPool&) = delete;
+
+    ~MaybeThreadPool() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : workers) {
+            t.join();
+        }
+    }
+
+    /*!
+     * A pool with one thread per core, shared by the whole program. It is
+     * never destroyed, so it can still be used during shutdown.
+     */
+    static MaybeThreadPool& shared() {
+        static MaybeThreadPool* pool = new MaybeThreadPool();
+        return *pool;
+    }
+
+    /*!
+     * The number of threads loops run on, counting the caller
+     */
+    unsigned size() const {
+        return static_cast<unsigned>(workers.size()) + 1;
+    }
+
+    /*!
+     * Calls f(i) for every i below chunks, spread over the pool, and
+     * returns once all of them are done. If any call throws, one of the
+     * exceptions is rethrown here once the rest have finished.
+     */
+    template <typename F>
+    void run(std::size_t chunks, F&& f) {
+        if (chunks == 0) {
+            return;
+        }
+        if (workers.empty() || chunks == 1 || inChunk()) {
+            for (std::size_t i = 0; i < chunks; ++i) {
+                f(i);
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> submit(submitLock);
+        Job j;
+        j.run = std::ref(f);
+        j.chunks = chunks;
+        j.next.store(0, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            job = &j;
+            ++generation;
+        }
+        wake.notify_all();
+
+        inChunk() = true;
+        work(j);
+        inChunk() = false;
+
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            idle.wait(guard, [&] { return active == 0; });
+            job = nullptr;
+        }
+
+#if MAYBE_EXCEPTIONS
+        if (j.error) {
+            std::rethrow_exception(j.error);
+        }
+#endif
+    }
+};
+
+/*!
+ * An iterator over the elements of [first, last) which hold a value,
+ * yielding either the elements themselves or, with Values, what they
+ * hold.
+ */
+template <typename It, bool Values>
+class MaybeEngagedIterator {
+
+    It cur;
+    It last;
+
+    void skip() {
+        while (cur != last && !*cur) {
+            ++cur;
+        }
+    }
+
+public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef typename std::conditional<Values, decltype(**std::declval<It&>()), decltype(*std::declval<It&>())>::type reference;
+    typedef typename std::remove_cv<typename std::remove_reference<reference>::type>::type value_type;
+    typedef typename std::iterator_traits<It>::difference_type difference_type;
+    typedef void pointer;
+
+    MaybeEngagedIterator() {}
+
+    MaybeEngagedIterator(It first, It last) : cur(first), last(last) {
+        skip();
+    }
+
+    reference operator*() const {
+        if constexpr (Values) {
+            return **cur;
+        } else {
+            return *cur;
+        }
+    }
+
+    MaybeEngagedIterator& operator++() {
+        ++cur;
+        skip();
+        return *this;
+    }
+
+    MaybeEngagedIterator operator++(int) {
+        MaybeEngagedIterator old = *this;
+        ++*this;
+        return old;
+    }
+
+    bool operator==(const MaybeEngagedIterator& other) const { return cur == other.cur; }
+    bool operator!=(const MaybeEngagedIterator& other) const { return cur != other.cur; }
+};
+
+/*!
+ * A view of the elements of a range of Maybes which hold a value; see
+ * maybe_engaged() and maybe_values(). It refers to the range rather than copying
+ * it.
+ */
+template <typename It, bool Values>
+class MaybeEngagedView {
+
+    It first;
+    It last;
+
+public:
+    typedef MaybeEngagedIterator<It, Values> iterator;
+    typedef iterator const_iterator;
+
+    MaybeEngagedView(It first, It last) : first(first), last(last) {}
+
+    iterator begin() const { return iterator(first, last); }
+    iterator end() const { return iterator(last, last); }
+};
+
+/*!
+ * The elements of a range of Maybes (or Maybe proxies, such as the
+ * elements of a MaybeVector) which hold a value
+ *
+ *     for (const Maybe<int>& m : maybe_engaged(column)) {
+ *         //m always has a value here
+ *     }
+ */
+template <typename Range>
+auto maybe_engaged(Range& range) -> MaybeEngagedView<decltype(std::begin(range)), false> {
+    return MaybeEngagedView<decltype(std::begin(range)), false>(std::begin(range), std::end(range));
+}
+
+/*!
+ * The values held by the elements of a range of Maybes, skipping the
+ * ones without
+ *
+ *     for (int v : maybe_values(column)) {
+ *         ...
+ *     }
+ */
+template <typename Range>
+auto maybe_values(Range& range) -> MaybeEngagedView<decltype(std::begin(range)), true> {
+    return MaybeEngagedView<decltype(std::begin(range)), true>(std::begin(range), std::end(range));
+}
+
+// The views refer to the range, so they can't be made from a temporary
+template <typename Range>
+void maybe_engaged(const Range&& range) = delete;
+
+template <typename Range>
+void maybe_values(const Range&& range) = delete;
+
+namespace Maybe_Detail
+{
+  /*!
+   * Elements per chunk when splitting a loop for the pool. A multiple of
+   * 64, so that chunks which start on a word boundary of a MaybeVector
+   * never share a bitmap word.
+   */
+  constexpr std::size_t parallelGrain = 4096;
+
+  /*!
+   * Runs f(i) for i below chunks, on pool when there is one
+   */
+  template <typename F>
+  void forChunks(MaybeThreadPool* pool, std::size_t chunks, F&& f) {
+      if (pool != nullptr) {
+          pool->run(chunks, f);
+      } else {
+          for (std::size_t i = 0; i < chunks; ++i) {
+              f(i);
+          }
+      }
+  }
+
+  /*!
+   * How many chunks to cut n elements into: enough for every thread to
+   * get a few, so that uneven ones even out, but no smaller than the
+   * grain.
+   */
+  inline std::size_t chunkCount(MaybeThreadPool* pool, std::size_t n) {
+      std::size_t byGrain = (n + parallelGrain - 1) / parallelGrain;
+      std::size_t byThreads = pool != nullptr ? std::size_t(pool->size()) * 4 : 1;
+      return std::min(byGrain, byThreads);
+  }
+
+  /*!
+   * Elements per chunk when cutting n elements into chunkCount() even
+   * chunks, rounded up to whole bitmap words
+   */
+  inline std::size_t chunkLength(MaybeThreadPool* pool, std::size_t n) {
+      std::size_t chunks = chunkCount(pool, n);
+      std::size_t words = (n + 63) / 64;
+      return chunks == 0 ? 64 : (words + chunks - 1) / chunks * 64;
+  }
+
+  /*!
+   * Cuts a MaybeVector's bitmap into at most chunks runs of words,
+   * holding about the same number of values each rather than the same
+   * number of elements, so stretches of empty elements cost next to
+   * nothing and don't leave threads idle. Returns the word each run
+   * starts at, followed by the total number of words.
+   */
+  inline std::vector<std::size_t> splitBitmap(const std::uint64_t* bits, std::size_t words, std::size_t chunks) {
+      std::vector<std::size_t> cuts(1, 0);
+      std::size_t total = 0;
+      for (std::size_t w = 0; w < words; ++w) {
+          total += MaybeVector_Detail::popcount(bits[w]);
+      }
+
+      std::size_t target = chunks != 0 ? total / chunks + 1 : total + 1;
+      std::size_t minWords = parallelGrain / 64;
+      std::size_t inChunk = 0;
+      for (std::size_t w = 0; w < words; ++w) {
+          inChunk += MaybeVector_Detail::popcount(bits[w]);
+          if (inChunk >= target && w + 1 - cuts.back() >= minWords && w + 1 < words) {
+              cuts.push_back(w + 1);
+              inChunk = 0;
+          }
+      }
+      cuts.push_back(words);
+      return cuts;
+  }
+
+  /*!
+   * Folds one more value into a chunk's partial result
+   */
+  template <typename Acc, typename Reduce, typename V>
+  void accumulate(Maybe<Acc>& partial, Reduce& reduce, V&& v) {
+      if (partial) {
+          *partial = reduce(std::move(*partial), std::forward<V>(v));
+      } else {
+          partial.emplace(std::forward<V>(v));
+      }
+  }
+
+  /*!
+   * Combines the chunks' partial results, in chunk order, onto init
+   */
+  template <typename Acc, typename Reduce>
+  Acc combine(Acc init, std::vector<Maybe<Acc> >& partials, Reduce& reduce) {
+      for (Maybe<Acc>& p : partials) {
+          if (p) {
+              init = reduce(std::move(init), std::move(*p));
+          }
+      }
+      return init;
+  }
+
+  template <typename Range, typename Acc, typename Reduce, typename Transform>
+  Acc transformReduce(MaybeThreadPool* pool, const Range& range, Acc init, Reduce reduce, Transform transform) {
+      auto first = std::begin(range);
+      std::size_t n = static_cast<std::size_t>(std::distance(first, std::end(range)));
+      std::size_t per = chunkLength(pool, n);
+      std::size_t chunks = (n + per - 1) / per;
+
+      std::vector<Maybe<Acc> > partials(chunks);
+      forChunks(pool, chunks, [&](std::size_t c) {
+          std::size_t end = std::min(n, (c + 1) * per);
+          auto it = first + c * per;
+          for (std::size_t i = c * per; i < end; ++i, ++it) {
+              if (*it) {
+                  accumulate(partials[c], reduce, transform(**it));
+              }
+          }
+      });
+      return combine(std::move(init), partials, reduce);
+  }
+
+  template <typename T, typename Acc, typename Reduce, typename Transform>
+  Acc transformReduce(MaybeThreadPool* pool, const MaybeVector<T>& v, Acc init, Reduce reduce, Transform transform) {
+      const std::uint64_t* bits = v.bitmap();
+      const T* data = v.data();
+      std::vector<std::size_t> cuts = splitBitmap(bits, v.bitmapWords(), chunkCount(pool, v.size()));
+
+      std::vector<Maybe<Acc> > partials(cuts.size() - 1);
+      forChunks(pool, partials.size(), [&](std::size_t c) {
+          for (std::size_t w = cuts[c]; w < cuts[c + 1]; ++w) {
+              for (std::uint64_t m = bits[w]; m != 0; m &= m - 1) {
+                  accumulate(partials[c], reduce, transform(data[w * 64 + MaybeVector_Detail::lowestBit(m)]));
+              }
+          }
+      });
+      return combine(std::move(init), partials, reduce);
+  }
+
+  /*!
+   * True for a MaybeVector's mutable iterator, which sets bits in a
+   * bitmap word shared with its neighbours when written through
+   */
+  template <typename It, typename = void>
+  struct IsMaybeVectorIterator : std::false_type {};
+
+  template <typename It>
+  struct IsMaybeVectorIterator<It, std::void_t<typename It::value_type::maybe_proxy_of> >
+      : std::is_same<It, typename MaybeVector<typename It::value_type::maybe_proxy_of>::iterator> {};
+
+  /*!
+   * How far into its bitmap word the output starts, so that chunks can be
+   * cut on the output's word boundaries rather than at multiples of the
+   * chunk length from wherever it starts. Zero for any other output.
+   */
+  template <typename OutIt>
+  std::size_t outputLead(const OutIt& out) {
+      if constexpr (IsMaybeVectorIterator<OutIt>::value) {
+          return out.position() % MaybeVector<typename OutIt::value_type::maybe_proxy_of>::wordBits;
+      } else {
+          (void)out;
+          return 0;
+      }
+  }
+
+  template <typename InIt, typename OutIt, typename F>
+  OutIt transform(MaybeThreadPool* pool, InIt first, InIt last, OutIt out, F f) {
+      typedef typename std::decay<decltype(f(**first))>::type U;
+
+      std::size_t n = static_cast<std::size_t>(std::distance(first, last));
+      std::size_t lead = outputLead(out);
+      std::size_t per = chunkLength(pool, n + lead);
+      std::size_t chunks = (n + lead + per - 1) / per;
+
+      //Chunk c covers output positions [c * per, (c + 1) * per) counted
+      //from the start of out's first word, less the lead
+      forChunks(pool, chunks, [&](std::size_t c) {
+          std::size_t begin = std::max(c * per, lead) - lead;
+          std::size_t end = std::min(n, (c + 1) * per - lead);
+          InIt in = first + begin;
+          OutIt o = out + begin;
+          for (std::size_t i = begin; i < end; ++i, ++in, ++o) {
+              if (*in) {
+                  *o = Maybe<U>(std::in_place, f(**in));
+              } else {
+                  *o = Maybe<U>();
+              }
+          }
+      });
+      return out + n;
+  }
+
+  template <typename T, typename F>
+  auto transform(MaybeThreadPool* pool, const MaybeVector<T>& v, F f)
+      -> MaybeVector<typename std::decay<decltype(f(std::declval<const T&>()))>::type> {
+      typedef typename std::decay<decltype(f(std::declval<const T&>()))>::type U;
+
+      MaybeVector<U> out(v.size());
+      const std::uint64_t* bits = v.bitmap();
+      const T* data = v.data();
+      std::copy(bits, bits + v.bitmapWords(), out.bitmap());
+
+      std::vector<std::size_t> cuts = splitBitmap(bits, v.bitmapWords(), chunkCount(pool, v.size()));
+      U* dest = out.data();
+      forChunks(pool, cuts.size() - 1, [&](std::size_t c) {
+          for (std::size_t w = cuts[c]; w < cuts[c + 1]; ++w) {
+              for (std::uint64_t m = bits[w]; m != 0; m &= m - 1) {
+                  std::size_t i = w * 64 + MaybeVector_Detail::lowestBit(m);
+                  dest[i] = f(data[i]);
+              }
+          }
+      });
+      return out;
+  }
+
+  struct Identity {
+      template <typename V>
+      V&& operator()(V&& v) const {
+          return std::forward<V>(v);
+      }
+  };
+
+#if MAYBE_STD_EXECUTION
+  template <typename Policy>
+  using EnableIfExecution = typename std::enable_if<std::is_execution_policy<typename std::decay<Policy>::type>::value>::type;
+
+  /*!
+   * The sequenced policy runs on the calling thread, and the rest on the
+   * shared pool
+   */
+  template <typename Policy>
+  MaybeThreadPool* poolFor(const Policy&) {
+      if (std::is_same<Policy, std::execution::sequenced_policy>::value) {
+          return nullptr;
+      }
+      return &MaybeThreadPool::shared();
+  }
+#endif
+}
+
+/*!
+ * Folds transform(v) for every value v held by the range's elements onto
+ * init with reduce, skipping elements without one, like
+ * std::transform_reduce. The range may be any random access range of
+ * Maybes or Maybe proxies; on a MaybeVector the validity bitmap is used
+ * to jump straight to the values.
+ *
+ * Run on a pool, reduce must be associative and commutative, as with
+ * std::reduce, since values are folded in per chunk.
+ *
+ *     double sum = maybe_transform_reduce(pool, prices, 0.0, std::plus<double>(),
+ *                                         [](const Price& p) { return p.amount; });
+ */
+template <typename Range, typename Acc, typename Reduce, typename Transform>
+Acc maybe_transform_reduce(MaybeThreadPool& pool, const Range& range, Acc init, Reduce reduce, Transform transform) {
+    return Maybe_Detail::transformReduce(&pool, range, std::move(init), reduce, transform);
+}
+
+template <typename Range, typename Acc, typename Reduce, typename Transform>
+Acc maybe_transform_reduce(const Range& range, Acc init, Reduce reduce, Transform transform) {
+    return Maybe_Detail::transformReduce(nullptr, range, std::move(init), reduce, transform);
+}
+
+/*!
+ * Folds every value held by the range's elements onto init with reduce,
+ * skipping elements without one, like std::reduce
+ */
+template <typename Range, typename Acc, typename Reduce>
+Acc maybe_reduce(MaybeThreadPool& pool, const Range& range, Acc init, Reduce reduce) {
+    return Maybe_Detail::transformReduce(&pool, range, std::move(init), reduce, Maybe_Detail::Identity());
+}
+
+template <typename Range, typename Acc, typename Reduce>
+Acc maybe_reduce(const Range& range, Acc init, Reduce reduce) {
+    return Maybe_Detail::transformReduce(nullptr, range, std::move(init), reduce, Maybe_Detail::Identity());
+}
+
+/*!
+ * Writes f applied to each element of [first, last) to out, like
+ * Maybe::map: elements with a value become a Maybe of f's result, and
+ * elements without one become an empty Maybe. Both ranges must be
+ * random access. Returns the end of the output.
+ */
+template <typename InIt, typename OutIt, typename F>
+OutIt maybe_transform(MaybeThreadPool& pool, InIt first, InIt last, OutIt out, F f) {
+    return Maybe_Detail::transform(&pool, first, last, out, f);
+}
+
+template <typename InIt, typename OutIt, typename F>
+OutIt maybe_transform(InIt first, InIt last, OutIt out, F f) {
+    return Maybe_Detail::transform(nullptr, first, last, out, f);
+}
+
+/*!
+ * Applies f to every value in v, giving a MaybeVector with the same
+ * elements empty. f is only called for elements with a value.
+ */
+template <typename T, typename F>
+auto maybe_transform(MaybeThreadPool& pool, const MaybeVector<T>& v, F f) -> decltype(Maybe_Detail::transform(&pool, v, f)) {
+    return Maybe_Detail::transform(&pool, v, f);
+}
+
+template <typename T, typename F>
+auto maybe_transform(const MaybeVector<T>& v, F f) -> decltype(Maybe_Detail::transform(nullptr, v, f)) {
+    return Maybe_Detail::transform(nullptr, v, f);
+}
+
+#if MAYBE_STD_EXECUTION
+/*!
+ * The algorithms above can also be given a standard execution policy in
+ * place of a pool: std::execution::seq runs on the calling thread, and
+ * the others run on MaybeThreadPool::shared().
+ */
+template <typename Policy, typename Range, typename Acc, typename Reduce, typename Transform,
+          typename = Maybe_Detail::EnableIfExecution<Policy> >
+Acc maybe_transform_reduce(Policy&& policy, const Range& range, Acc init, Reduce reduce, Transform transform) {
+    return Maybe_Detail::transformReduce(Maybe_Detail::poolFor(policy), range, std::move(init), reduce, transform);
+}
+
+template <typename Policy, typename Range, typename Acc, typename Reduce,
+          typename = Maybe_Detail::EnableIfExecution<Policy> >
+Acc maybe_reduce(Policy&& policy, const Range& range, Acc init, Reduce reduce) {
+    return Maybe_Detail::transformReduce(Maybe_Detail::poolFor(policy), range, std::move(init), reduce, Maybe_Detail::Identity());
+}
+
+template <typename Policy, typename InIt, typename OutIt, typename F,
+          typename = Maybe_Detail::EnableIfExecution<Policy> >
+OutIt maybe_transform(Policy&& policy, InIt first, InIt last, OutIt out, F f) {
+    return Maybe_Detail::transform(Maybe_Detail::poolFor(policy), first, last, out, f);
+}
+
+template <typename Policy, typename T, typename F, typename = Maybe_Detail::EnableIfExecution<Policy> >
+auto maybe_transform(Policy&& policy, const MaybeVector<T>& v, F f) -> decltype(Maybe_Detail::transform(nullptr, v, f)) {
+    return Maybe_Detail::transform(Maybe_Detail::poolFor(policy), v, f);
+}
+#endif
+
+#endif
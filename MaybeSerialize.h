@@ -0,0 +1,503 @@
+#ifndef MAYBE_SERIALIZE_H
+#define MAYBE_SERIALIZE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "Maybe.h"
+#include "MaybeVector.h"
+
+/*
+ * A binary format for Maybes and MaybeVectors.
+ *
+ *     Maybe<T>        presence byte (0 or 1), then if it is 1, the value
+ *     MaybeVector<T>  element count (uint64), the validity bitmap as
+ *                     uint64 words, then the values
+ *
+ * Trivially copyable values with no padding bytes (see
+ * maybe_zero_padded) are written as their raw bytes, aligned to
+ * alignof(T) from the start of the stream, and a MaybeVector of them is
+ * written as its whole value array, including slots with no value. That
+ * means a reader can hand out Maybe<const T&> and MaybeVectorView views
+ * straight into the buffer, as long as the buffer itself starts at an
+ * address aligned for T (a memory mapped file or a malloc'd buffer
+ * always is). Other types are written value by value through
+ * maybe_serializer<T>, and only engaged elements are.
+ *
+ * Everything is in host byte order; this is for talking between
+ * machines of the same endianness, not an interchange format.
+ *
+ *     std::vector<unsigned char> buf;
+ *     MaybeWriter<> out(buf);
+ *     out.write(price);
+ *     out.write(column);
+ *
+ *     MaybeReader in(buf.data(), buf.size());
+ *     Maybe<const double&> p = in.view<double>();
+ *     MaybeVectorView<int> c = in.viewVector<int>();
+ */
+
+/*!
+ * Exception thrown when a MaybeReader finds input it cannot decode
+ */
+class maybe_format_error : public std::runtime_error {
+public:
+    explicit maybe_format_error(const char* what) : runtime_error(what) {}
+};
+
+namespace Maybe_Detail
+{
+  [[noreturn]] inline void throwFormatError(const char* what) {
+#if MAYBE_EXCEPTIONS
+      throw maybe_format_error(what);
+#else
+      (void)what;
+      std::abort();
+#endif
+  }
+}
+
+/*!
+ * True for a trivially copyable T whose padding bytes are always zero,
+ * so that writing its object representation gives the same bytes for
+ * the same values. Scalars and types with unique object representations
+ * need no specialization; other types are written through
+ * maybe_serializer<T> unless this is specialized for them. That is safe
+ * for a struct with no padding whose members include floating point
+ * (which never has unique object representations), or for one whose
+ * every instance is zero filled (by memset, or value initialization)
+ * before its members are set.
+ */
+template <typename T>
+struct maybe_zero_padded : std::integral_constant<bool,
+    std::is_scalar<T>::value || std::has_unique_object_representations<T>::value> {};
+
+namespace Maybe_Detail
+{
+  template <typename T>
+  struct IsRawSerialized : std::integral_constant<bool,
+      std::is_trivially_copyable<T>::value && maybe_zero_padded<T>::value> {};
+}
+
+/*!
+ * Says how to write and read a T which is not written raw, because it
+ * is not trivially copyable or has padding. A specialization provides:
+ *
+ *     template <typename W> static void write(W& out, const T& value);
+ *     static T read(MaybeReader& in);
+ *
+ * using the writer's and reader's value() and bytes() members.
+ */
+template <typename T>
+struct maybe_serializer;
+
+/*!
+ * Sink which appends to a byte vector
+ */
+class MaybeByteSink {
+
+    std::vector<unsigned char>* out;
+
+public:
+    MaybeByteSink(std::vector<unsigned char>& out) : out(&out) {}
+
+    void write(const void* p, std::size_t n) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(p);
+        out->insert(out->end(), bytes, bytes + n);
+    }
+};
+
+/*!
+ * Sink which writes to a std::ostream, reporting a failed write when the
+ * stream's failbit or badbit is set
+ */
+class MaybeStreamSink {
+
+    std::ostream* out;
+
+public:
+    MaybeStreamSink(std::ostream& out) : out(&out) {}
+
+    bool write(const void* p, std::size_t n) {
+        out->write(static_cast<const char*>(p), static_cast<std::streamsize>(n));
+        return !out->fail();
+    }
+};
+
+/*!
+ * Writes Maybes to a Sink, anything with a write(const void*, size_t)
+ * member. Each value or block is handed to the sink in a constant
+ * number of calls, however many elements it has.
+ *
+ * A sink whose write returns bool reports failure by returning false.
+ * From then on good() is false and nothing more is handed to the sink,
+ * like a std::ostream once it has failed.
+ */
+template <typename Sink = MaybeByteSink>
+class MaybeWriter {
+
+    Sink sink;
+    std::size_t offset;
+    bool ok;
+
+public:
+    explicit MaybeWriter(Sink sink) : sink(sink), offset(0), ok(true) {}
+
+    /*!
+     * Bytes written so far, counting any the sink failed to take
+     */
+    std::size_t position() const {
+        return offset;
+    }
+
+    /*!
+     * Checks that the sink has taken everything written so far
+     */
+    bool good() const {
+        return ok;
+    }
+
+    /*!
+     * Writes n raw bytes
+     */
+    void bytes(const void* p, std::size_t n) {
+        if (n != 0) {
+            if (ok) {
+                if constexpr (std::is_same<decltype(sink.write(p, n)), bool>::value) {
+                    ok = sink.write(p, n);
+                } else {
+                    sink.write(p, n);
+                }
+            }
+            offset += n;
+        }
+    }
+
+    /*!
+     * Writes zeros up to the next multiple of align
+     */
+    void pad(std::size_t align) {
+        static const unsigned char zeros[64] = {};
+        std::size_t n = (align - offset % align) % align;
+        while (n != 0) {
+            std::size_t chunk = n < sizeof(zeros) ? n : sizeof(zeros);
+            bytes(zeros, chunk);
+            n -= chunk;
+        }
+    }
+
+    /*!
+     * Writes a bare value
+     */
+    template <typename T>
+    void value(const T& v) {
+        if constexpr (Maybe_Detail::IsRawSerialized<T>::value) {
+            pad(alignof(T));
+            bytes(std::addressof(v), sizeof(T));
+        } else {
+            maybe_serializer<T>::write(*this, v);
+        }
+    }
+
+    /*!
+     * Writes a presence byte and, if there is one, the value. Works for
+     * any storage policy, and for Maybe<T&>.
+     */
+    template <typename T, typename Policy>
+    void write(const Maybe<T, Policy>& m) {
+        typedef typename std::remove_cv<typename std::remove_reference<T>::type>::type Value;
+
+        unsigned char present = m ? 1 : 0;
+        bytes(&present, 1);
+        if (m) {
+            value<Value>(*m);
+        }
+    }
+
+    /*!
+     * Writes a whole MaybeVector. For T written raw that is the
+     * count, the bitmap and the value array, in three sink calls.
+     */
+    template <typename T>
+    void write(const MaybeVector<T>& v) {
+        value<std::uint64_t>(v.size());
+        bytes(v.bitmap(), v.bitmapWords() * sizeof(std::uint64_t));
+
+        if constexpr (Maybe_Detail::IsRawSerialized<T>::value) {
+            pad(alignof(T));
+            bytes(v.data(), v.size() * sizeof(T));
+        } else {
+            for (std::size_t i = 0; i < v.size(); ++i) {
+                if (v.has_value(i)) {
+                    value<T>(v.data()[i]);
+                }
+            }
+        }
+    }
+};
+
+/*!
+ * Read-only view of a MaybeVector block inside a MaybeReader's buffer.
+ * It is only valid for as long as the buffer is.
+ */
+template <typename T>
+class MaybeVectorView {
+
+    friend class MaybeReader;
+
+    const T* values;
+    const std::uint64_t* bits;
+    std::size_t count;
+
+    MaybeVectorView(const T* values, const std::uint64_t* bits, std::size_t count)
+        : values(values), bits(bits), count(count) {}
+
+public:
+    typedef std::size_t size_type;
+
+    MaybeVectorView() : values(nullptr), bits(nullptr), count(0) {}
+
+    size_type size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    /*!
+     * Checks if element i holds a value
+     */
+    bool has_value(size_type i) const {
+        return (bits[i / 64] >> (i % 64)) & 1;
+    }
+
+    /*!
+     * Element i, referring into the buffer
+     */
+    Maybe<const T&> operator[](size_type i) const {
+        return has_value(i) ? Maybe<const T&>(values[i]) : Maybe<const T&>();
+    }
+
+    /*!
+     * The value array and bitmap, laid out as in MaybeVector
+     */
+    const T* data() const {
+        return values;
+    }
+
+    const std::uint64_t* bitmap() const {
+        return bits;
+    }
+
+    size_type bitmapWords() const {
+        return (count + 63) / 64;
+    }
+};
+
+/*!
+ * Reads what a MaybeWriter wrote from a contiguous buffer, without
+ * taking ownership of it. Truncated or malformed input throws a
+ * maybe_format_error.
+ */
+class MaybeReader {
+
+    const unsigned char* begin;
+    std::size_t size;
+    std::size_t offset;
+
+    template <typename T>
+    static void checkAligned(const void* p) {
+        if (reinterpret_cast<std::uintptr_t>(p) % alignof(T) != 0) {
+            Maybe_Detail::throwFormatError("buffer is not aligned for a zero-copy view");
+        }
+    }
+
+    /*!
+     * Checks that a block of n elements could fit in what is left,
+     * before anything is sized from n.
+     */
+    void checkCount(std::uint64_t n) const {
+        if (n / 8 > size - offset) {
+            Maybe_Detail::throwFormatError("MaybeVector block is longer than the buffer");
+        }
+    }
+
+    std::uint64_t readBitmap(std::uint64_t n, const std::uint64_t*& bits) {
+        checkCount(n);
+        std::size_t words = static_cast<std::size_t>((n + 63) / 64);
+        bits = static_cast<const std::uint64_t*>(take(words * sizeof(std::uint64_t), alignof(std::uint64_t)));
+        return words;
+    }
+
+public:
+    MaybeReader(const void* data, std::size_t size)
+        : begin(static_cast<const unsigned char*>(data)), size(size), offset(0) {}
+
+    /*!
+     * Bytes read so far
+     */
+    std::size_t position() const {
+        return offset;
+    }
+
+    bool exhausted() const {
+        return offset == size;
+    }
+
+    /*!
+     * Skips to the next multiple of align, then returns a pointer to the
+     * next n bytes and steps past them
+     */
+    const void* take(std::size_t n, std::size_t align = 1) {
+        std::size_t start = offset + (align - offset % align) % align;
+        if (start > size || n > size - start) {
+            Maybe_Detail::throwFormatError("unexpected end of MaybeReader input");
+        }
+        offset = start + n;
+        return begin + start;
+    }
+
+    /*!
+     * Copies the next n raw bytes out
+     */
+    void bytes(void* out, std::size_t n) {
+        std::memcpy(out, take(n), n);
+    }
+
+    /*!
+     * Reads a bare value
+     */
+    template <typename T>
+    T value() {
+        if constexpr (Maybe_Detail::IsRawSerialized<T>::value) {
+            T v;
+            std::memcpy(std::addressof(v), take(sizeof(T), alignof(T)), sizeof(T));
+            return v;
+        } else {
+            return maybe_serializer<T>::read(*this);
+        }
+    }
+
+    /*!
+     * Reads a Maybe, copying the value out
+     */
+    template <typename T>
+    Maybe<T> read() {
+        if (!present()) {
+            return Maybe<T>();
+        }
+        return Maybe<T>(std::in_place, value<T>());
+    }
+
+    /*!
+     * Reads a Maybe of a raw written T as a reference into the
+     * buffer, without copying it
+     */
+    template <typename T>
+    Maybe<const T&> view() {
+        static_assert(Maybe_Detail::IsRawSerialized<T>::value, "only values written raw (trivially copyable, with no padding) can be viewed in place");
+
+        if (!present()) {
+            return Maybe<const T&>();
+        }
+        const void* p = take(sizeof(T), alignof(T));
+        checkAligned<T>(p);
+        return Maybe<const T&>(*static_cast<const T*>(p));
+    }
+
+    /*!
+     * Reads a presence byte
+     */
+    bool present() {
+        unsigned char flag = *static_cast<const unsigned char*>(take(1));
+        if (flag > 1) {
+            Maybe_Detail::throwFormatError("bad Maybe presence byte");
+        }
+        return flag == 1;
+    }
+
+    /*!
+     * Reads a MaybeVector block into a new MaybeVector
+     */
+    template <typename T>
+    MaybeVector<T> readVector() {
+        std::uint64_t n = value<std::uint64_t>();
+        const std::uint64_t* bits;
+        std::size_t words = readBitmap(n, bits);
+
+        MaybeVector<T> v;
+        if constexpr (Maybe_Detail::IsRawSerialized<T>::value) {
+            const void* values = take(static_cast<std::size_t>(n) * sizeof(T), alignof(T));
+            v.resize(static_cast<std::size_t>(n));
+            std::memcpy(v.data(), values, static_cast<std::size_t>(n) * sizeof(T));
+            std::memcpy(v.bitmap(), bits, words * sizeof(std::uint64_t));
+            if (n % 64 != 0) {
+                v.bitmap()[words - 1] &= (std::uint64_t(1) << (n % 64)) - 1;
+            }
+        } else {
+            v.reserve(static_cast<std::size_t>(n));
+            for (std::uint64_t i = 0; i < n; ++i) {
+                std::uint64_t word;
+                std::memcpy(&word, bits + i / 64, sizeof(word));
+                if ((word >> (i % 64)) & 1) {
+                    v.push_back(value<T>());
+                } else {
+                    v.push_back(nullptr);
+                }
+            }
+        }
+        return v;
+    }
+
+    /*!
+     * Reads a MaybeVector block of a raw written T as a view
+     * into the buffer, without copying it
+     */
+    template <typename T>
+    MaybeVectorView<T> viewVector() {
+        static_assert(Maybe_Detail::IsRawSerialized<T>::value, "only values written raw (trivially copyable, with no padding) can be viewed in place");
+
+        std::uint64_t n = value<std::uint64_t>();
+        const std::uint64_t* bits;
+        readBitmap(n, bits);
+        checkAligned<std::uint64_t>(bits);
+
+        const void* values = take(static_cast<std::size_t>(n) * sizeof(T), alignof(T));
+        checkAligned<T>(values);
+        return MaybeVectorView<T>(static_cast<const T*>(values), bits, static_cast<std::size_t>(n));
+    }
+};
+
+/*!
+ * Strings are written as a uint64 length and then their characters
+ */
+template <typename C, typename Tr, typename A>
+struct maybe_serializer<std::basic_string<C, Tr, A> > {
+    static_assert(std::is_trivially_copyable<C>::value, "string characters must be trivially copyable");
+
+    template <typename W>
+    static void write(W& out, const std::basic_string<C, Tr, A>& s) {
+        out.template value<std::uint64_t>(s.size());
+        out.bytes(s.data(), s.size() * sizeof(C));
+    }
+
+    static std::basic_string<C, Tr, A> read(MaybeReader& in) {
+        std::uint64_t n = in.value<std::uint64_t>();
+        if (n > std::size_t(-1) / sizeof(C)) {
+            Maybe_Detail::throwFormatError("string is longer than the buffer");
+        }
+        const void* p = in.take(static_cast<std::size_t>(n) * sizeof(C));
+        std::basic_string<C, Tr, A> s(static_cast<std::size_t>(n), C());
+        std::memcpy(&s[0], p, static_cast<std::size_t>(n) * sizeof(C));
+        return s;
+    }
+};
+
+#endif
@@ -0,0 +1,256 @@
+#ifndef MAYBE_SLAB_H
+#define MAYBE_SLAB_H
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+#include "Maybe.h"
+
+#if MAYBE_ASAN
+#include <sanitizer/lsan_interface.h>
+#endif
+
+namespace Maybe_Detail
+{
+  /*!
+   * A pool of fixed size blocks for one size and alignment. Each thread
+   * keeps a free list of its own, so allocating and freeing is a pop or
+   * push on it with no locking. Only when a thread's list runs dry, or
+   * grows past two batches, does it take the pool lock to move a batch
+   * of blocks from or to the shared list. The shared list is refilled by
+   * carving new slabs from the global heap.
+   *
+   * Slabs are never handed back to the heap, and the pool itself is
+   * never destroyed, so boxed Maybes in static objects can still be
+   * freed during shutdown.
+   */
+  template <std::size_t Size, std::size_t Align>
+  class SlabPool {
+
+      struct Node {
+          Node* next;
+      };
+
+      static constexpr std::size_t nodeAlign = Align > alignof(Node) ? Align : alignof(Node);
+      static constexpr std::size_t nodeSize =
+          ((Size > sizeof(Node) ? Size : sizeof(Node)) + nodeAlign - 1) / nodeAlign * nodeAlign;
+      static constexpr std::size_t batch = nodeSize <= 256 ? 64 : 16;
+      static constexpr std::size_t slabNodes = batch * 8;
+
+      /*!
+       * One thread's free blocks. Whatever is left when the thread exits
+       * goes back to the shared list.
+       */
+      struct Cache {
+          Node* head = nullptr;
+          std::size_t count = 0;
+
+          ~Cache() {
+              instance().drain(*this, count);
+              cacheGone() = true;
+          }
+      };
+
+      std::mutex lock;
+      Node* freeList;
+      char* bump;
+      char* bumpEnd;
+
+      SlabPool() : freeList(nullptr), bump(nullptr), bumpEnd(nullptr) {}
+
+      /*!
+       * Free blocks are poisoned under AddressSanitizer, all but while
+       * their link is read or written, so stale pointers into them are
+       * caught.
+       */
+      static Node* nextOf(Node* n) {
+          MAYBE_UNPOISON(n, sizeof(Node));
+          Node* next = n->next;
+          MAYBE_POISON(n, nodeSize);
+          return next;
+      }
+
+      static void link(Node* n, Node* next) {
+          MAYBE_UNPOISON(n, sizeof(Node));
+          n->next = next;
+          MAYBE_POISON(n, nodeSize);
+      }
+
+      static Cache& cache() {
+          static thread_local Cache c;
+          return c;
+      }
+
+      /*!
+       * Set once this thread's cache has been destroyed, so that blocks
+       * freed by later thread-local destructors go straight to the
+       * shared list.
+       */
+      static bool& cacheGone() {
+          static thread_local bool gone = false;
+          return gone;
+      }
+
+      /*!
+       * Hands out one block from the shared list, or from a new slab.
+       * Must be called with the lock held.
+       */
+      Node* takeShared() {
+          if (freeList != nullptr) {
+              Node* n = freeList;
+              freeList = nextOf(n);
+              return n;
+          }
+          if (bump == bumpEnd) {
+              bump = static_cast<char*>(::operator new(nodeSize * slabNodes, std::align_val_t(nodeAlign)));
+              bumpEnd = bump + nodeSize * slabNodes;
+#if MAYBE_ASAN
+              // Slabs are only reachable through the free lists, which
+              // run through poisoned blocks that leak checking does not
+              // scan, so they would be reported as leaked at exit
+              __lsan_ignore_object(bump);
+#endif
+          }
+          Node* n = reinterpret_cast<Node*>(bump);
+          bump += nodeSize;
+          return n;
+      }
+
+      void refill(Cache& c) {
+          std::lock_guard<std::mutex> guard(lock);
+          while (c.count < batch) {
+              Node* n = takeShared();
+              link(n, c.head);
+              c.head = n;
+              ++c.count;
+          }
+      }
+
+      /*!
+       * Moves the first n blocks of c onto the shared list
+       */
+      void drain(Cache& c, std::size_t n) {
+          if (n == 0) {
+              return;
+          }
+
+          Node* first = c.head;
+          Node* last = first;
+          for (std::size_t i = 1; i < n; ++i) {
+              last = nextOf(last);
+          }
+          c.head = nextOf(last);
+          c.count -= n;
+
+          std::lock_guard<std::mutex> guard(lock);
+          link(last, freeList);
+          freeList = first;
+      }
+
+  public:
+      SlabPool(const SlabPool&) = delete;
+      SlabPool& operator=(const SlabPool&) = delete;
+
+      static SlabPool& instance() {
+          static SlabPool* pool = new SlabPool();
+          return *pool;
+      }
+
+      void* allocate() {
+          if (cacheGone()) {
+              std::lock_guard<std::mutex> guard(lock);
+              Node* n = takeShared();
+              MAYBE_UNPOISON(n, nodeSize);
+              return n;
+          }
+
+          Cache& c = cache();
+          if (c.head == nullptr) {
+              refill(c);
+          }
+          Node* n = c.head;
+          c.head = nextOf(n);
+          --c.count;
+          MAYBE_UNPOISON(n, nodeSize);
+          return n;
+      }
+
+      void deallocate(void* p) {
+          Node* n = static_cast<Node*>(p);
+          if (cacheGone()) {
+              std::lock_guard<std::mutex> guard(lock);
+              link(n, freeList);
+              freeList = n;
+              return;
+          }
+
+          Cache& c = cache();
+          link(n, c.head);
+          c.head = n;
+          if (++c.count >= 2 * batch) {
+              drain(c, batch);
+          }
+      }
+  };
+}
+
+/*!
+ * Allocator which serves single objects from a per-type slab pool (see
+ * Maybe_Detail::SlabPool), so that creating and destroying a boxed Maybe
+ * is usually just a pointer pop and push on a thread-local free list,
+ * and same-sized boxes sit next to each other instead of being spread
+ * across the heap.
+ *
+ *     Maybe<Message, MaybeSlabBoxed> m(bytes);
+ *
+ * Requests for more than one object go to the global heap. The
+ * allocator is stateless, and any block can be freed on any thread.
+ */
+template <typename T>
+class MaybeSlabAllocator {
+
+    typedef Maybe_Detail::SlabPool<sizeof(T), alignof(T)> Pool;
+
+public:
+    typedef T value_type;
+    typedef std::true_type is_always_equal;
+
+    MaybeSlabAllocator() = default;
+
+    template <typename U>
+    MaybeSlabAllocator(const MaybeSlabAllocator<U>&) {}
+
+    T* allocate(std::size_t n) {
+        if (n == 1) {
+            return static_cast<T*>(Pool::instance().allocate());
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+    }
+
+    void deallocate(T* p, std::size_t n) {
+        if (n == 1) {
+            Pool::instance().deallocate(p);
+        } else {
+            ::operator delete(p, std::align_val_t(alignof(T)));
+        }
+    }
+
+    template <typename U>
+    bool operator==(const MaybeSlabAllocator<U>&) const {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const MaybeSlabAllocator<U>&) const {
+        return false;
+    }
+};
+
+/*!
+ * Storage policy for Maybes boxed in slab pool memory
+ */
+typedef MaybeBoxed<MaybeSlabAllocator<char> > MaybeSlabBoxed;
+
+#endif
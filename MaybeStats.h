@@ -0,0 +1,259 @@
+#ifndef MAYBE_STATS_H
+#define MAYBE_STATS_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+/*
+ * Counters for how Maybes are used, per payload type and storage
+ * policy. Maybe.h only calls into this when it is compiled with
+ * MAYBE_INSTRUMENTATION defined to 1; otherwise none of it is included
+ * and the hooks expand to nothing.
+ *
+ * Each thread counts into its own blocks and folds them into the shared
+ * totals every few thousand events and when it exits, so the hot path
+ * never touches a shared cache line. A snapshot therefore lags slightly
+ * behind; call MaybeStats::flushThread() first to include the calling
+ * thread's latest counts.
+ *
+ * Copies and moves of trivially copyable Maybes are plain memcpys and
+ * are not counted.
+ */
+namespace MaybeStats
+{
+  enum Counter {
+      Constructions,
+      Copies,
+      Moves,
+      Allocations,
+      Deallocations,
+      BytesAllocated,
+      BytesFreed,
+      EmptyAccesses,
+      CounterCount
+  };
+
+  inline const char* counterName(Counter c) {
+      static const char* const names[CounterCount] = {
+          "constructions", "copies", "moves", "allocations",
+          "deallocations", "bytes_allocated", "bytes_freed", "empty_accesses"
+      };
+      return names[c];
+  }
+
+  /*!
+   * The counts for one (payload type, storage policy) pair at the time
+   * of the snapshot
+   */
+  struct Entry {
+      std::string type;
+      std::string storage;
+      std::uint64_t counts[CounterCount];
+
+      std::uint64_t operator[](Counter c) const {
+          return counts[c];
+      }
+
+      /*!
+       * Bytes allocated for boxed values which have not been freed yet
+       */
+      std::uint64_t liveBytes() const {
+          return counts[BytesAllocated] - counts[BytesFreed];
+      }
+  };
+
+  typedef std::vector<Entry> Snapshot;
+
+  namespace Detail
+  {
+      /*!
+       * Readable name of T, taken from the compiler's function signature
+       * where it offers one
+       */
+      template <typename T>
+      std::string typeName() {
+#if defined(__GNUC__) || defined(__clang__)
+          std::string sig = __PRETTY_FUNCTION__;
+          std::string::size_type start = sig.find("T = ");
+          if (start != std::string::npos) {
+              start += 4;
+              std::string::size_type end = sig.find_first_of(";]", start);
+              return sig.substr(start, end - start);
+          }
+#endif
+#if defined(__cpp_rtti) || defined(__GXX_RTTI)
+          return typeid(T).name();
+#else
+          return "?";
+#endif
+      }
+
+      /*!
+       * The shared totals for one (T, Policy) pair, kept in a list so a
+       * snapshot can find them all
+       */
+      struct Totals {
+          std::string type;
+          std::string storage;
+          std::atomic<std::uint64_t> counts[CounterCount];
+          Totals* next;
+      };
+
+      struct Registry {
+          std::mutex lock;
+          Totals* head;
+
+          static Registry& instance() {
+              static Registry registry{{}, nullptr};
+              return registry;
+          }
+      };
+
+      template <typename T, typename Policy>
+      Totals& totalsFor() {
+          static Totals* totals = [] {
+              Totals* t = new Totals();
+              t->type = typeName<T>();
+              t->storage = typeName<Policy>();
+              for (std::atomic<std::uint64_t>& c : t->counts) {
+                  c.store(0, std::memory_order_relaxed);
+              }
+              Registry& registry = Registry::instance();
+              std::lock_guard<std::mutex> guard(registry.lock);
+              t->next = registry.head;
+              registry.head = t;
+              return t;
+          }();
+          return *totals;
+      }
+
+      struct LocalBlock;
+
+      inline LocalBlock*& threadBlocks() {
+          static thread_local LocalBlock* head = nullptr;
+          return head;
+      }
+
+      /*!
+       * One thread's pending counts for one (T, Policy) pair
+       */
+      struct LocalBlock {
+          static const unsigned flushEvery = 4096;
+
+          Totals& totals;
+          std::uint64_t pending[CounterCount];
+          unsigned events;
+          LocalBlock* next;
+          bool* gone;
+
+          LocalBlock(Totals& totals, bool* gone)
+              : totals(totals), pending(), events(0), next(threadBlocks()), gone(gone) {
+              threadBlocks() = this;
+          }
+
+          /*!
+           * Thread locals die in reverse order of construction, so this
+           * block is always the head of the thread's list by now.
+           */
+          ~LocalBlock() {
+              flush();
+              threadBlocks() = next;
+              *gone = true;
+          }
+
+          void flush() {
+              for (int c = 0; c < CounterCount; ++c) {
+                  if (pending[c] != 0) {
+                      totals.counts[c].fetch_add(pending[c], std::memory_order_relaxed);
+                      pending[c] = 0;
+                  }
+              }
+              events = 0;
+          }
+      };
+  }
+
+  /*!
+   * Adds n to a counter for Maybe<T, Policy>. It never throws, since it
+   * is called from noexcept moves: if the counters can't be set up, the
+   * event is dropped.
+   *
+   * Once the thread's block has been destroyed, e.g. when a static Maybe
+   * dies after the main thread's thread locals, counts go straight to
+   * the shared totals instead. The flag saying so is trivially
+   * destructible, so it can still be read then.
+   */
+  template <typename T, typename Policy>
+  void record(Counter c, std::uint64_t n) noexcept {
+      static thread_local bool blockGone = false;
+
+      if (blockGone) {
+          Detail::totalsFor<T, Policy>().counts[c].fetch_add(n, std::memory_order_relaxed);
+          return;
+      }
+
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+      try {
+#endif
+          static thread_local Detail::LocalBlock block(Detail::totalsFor<T, Policy>(), &blockGone);
+          block.pending[c] += n;
+          if (++block.events >= Detail::LocalBlock::flushEvery) {
+              block.flush();
+          }
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+      } catch (...) {
+      }
+#endif
+  }
+
+  /*!
+   * Folds the calling thread's pending counts into the shared totals
+   */
+  inline void flushThread() {
+      for (Detail::LocalBlock* b = Detail::threadBlocks(); b != nullptr; b = b->next) {
+          b->flush();
+      }
+  }
+
+  /*!
+   * Copies out the shared totals for every type seen so far
+   */
+  inline Snapshot snapshot() {
+      Snapshot out;
+      Detail::Registry& registry = Detail::Registry::instance();
+      std::lock_guard<std::mutex> guard(registry.lock);
+      for (Detail::Totals* t = registry.head; t != nullptr; t = t->next) {
+          Entry e;
+          e.type = t->type;
+          e.storage = t->storage;
+          for (int c = 0; c < CounterCount; ++c) {
+              e.counts[c] = t->counts[c].load(std::memory_order_relaxed);
+          }
+          out.push_back(e);
+      }
+      return out;
+  }
+
+  /*!
+   * Writes a snapshot as one line per type, e.g.
+   *
+   *     Maybe<std::string, MaybeInline> constructions=10 copies=2 ...
+   */
+  inline std::ostream& operator<<(std::ostream& os, const Snapshot& s) {
+      for (const Entry& e : s) {
+          os << "Maybe<" << e.type << ", " << e.storage << ">";
+          for (int c = 0; c < CounterCount; ++c) {
+              os << ' ' << counterName(Counter(c)) << '=' << e.counts[c];
+          }
+          os << '\n';
+      }
+      return os;
+  }
+}
+
+#endif
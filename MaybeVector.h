@@ -0,0 +1,566 @@
+#ifndef MAYBE_VECTOR_H
+#define MAYBE_VECTOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Maybe.h"
+
+namespace Maybe_Detail
+{
+  /*!
+   * The value column of a MaybeVector<bool>. std::vector<bool> packs its
+   * bits and hands out proxies, so it has no data() and no bool& to give
+   * out; this is a plain growable array of bool with the few vector
+   * operations MaybeVector uses.
+   */
+  class DenseBools {
+
+      std::unique_ptr<bool[]> buf;
+      std::size_t count;
+      std::size_t cap;
+
+      void grow(std::size_t want) {
+          if (want <= cap) {
+              return;
+          }
+          std::size_t next = std::max(want, 2 * cap);
+          std::unique_ptr<bool[]> bigger(new bool[next]());
+          std::copy(buf.get(), buf.get() + count, bigger.get());
+          buf = std::move(bigger);
+          cap = next;
+      }
+
+  public:
+      DenseBools() : count(0), cap(0) {}
+
+      explicit DenseBools(std::size_t n) : buf(n == 0 ? nullptr : new bool[n]()), count(n), cap(n) {}
+
+      DenseBools(const DenseBools& other)
+          : buf(other.count == 0 ? nullptr : new bool[other.count]), count(other.count), cap(other.count) {
+          std::copy(other.buf.get(), other.buf.get() + count, buf.get());
+      }
+
+      DenseBools(DenseBools&& other) noexcept : buf(std::move(other.buf)), count(other.count), cap(other.cap) {
+          other.count = 0;
+          other.cap = 0;
+      }
+
+      DenseBools& operator=(DenseBools other) noexcept {
+          std::swap(buf, other.buf);
+          std::swap(count, other.count);
+          std::swap(cap, other.cap);
+          return *this;
+      }
+
+      std::size_t size() const { return count; }
+      bool empty() const { return count == 0; }
+
+      void reserve(std::size_t n) { grow(n); }
+      void clear() { count = 0; }
+
+      /*!
+       * New elements are false
+       */
+      void resize(std::size_t n) {
+          grow(n);
+          if (n > count) {
+              std::fill(buf.get() + count, buf.get() + n, false);
+          }
+          count = n;
+      }
+
+      template <typename... Ts>
+      void emplace_back(Ts&&... args) {
+          grow(count + 1);
+          buf[count] = bool(std::forward<Ts>(args)...);
+          ++count;
+      }
+
+      void pop_back() { --count; }
+
+      bool* data() { return buf.get(); }
+      const bool* data() const { return buf.get(); }
+
+      bool& operator[](std::size_t i) { return buf[i]; }
+      const bool& operator[](std::size_t i) const { return buf[i]; }
+  };
+
+  /*!
+   * The container a MaybeVector<T> keeps its values in
+   */
+  template <typename T>
+  struct DenseValues {
+      typedef std::vector<T> type;
+  };
+
+  template <>
+  struct DenseValues<bool> {
+      typedef DenseBools type;
+  };
+}
+
+/*!
+ * A sequence of Maybe<T>, stored as columns: one dense array of T and a
+ * bitmap with one bit per element saying whether it holds a value
+ * (Arrow style, least significant bit first). Scanning the validity of a
+ * million elements only touches 16KB of bitmap, and the values are
+ * contiguous rather than scattered across the heap.
+ *
+ * Elements without a value still have a T in the array, so T must be
+ * default constructible. Bits past size() are always zero. A
+ * MaybeVector<bool> keeps a whole bool per value rather than a bit, so
+ * that data() and the references it hands out are real bools.
+ *
+ * Indexing hands out proxies which behave like a Maybe<T>&: they test,
+ * extract, assign and compare with the same rules as Maybe, and
+ * convert to a Maybe<T> when a copy is wanted.
+ *
+ *     MaybeVector<int> column;
+ *     column.push_back(1);
+ *     column.push_back(nullptr);
+ *
+ *     if (column[1]) {
+ *         //will not get here
+ *     }
+ *     column[1] = 10;
+ *     Maybe<int> copy = column[1];
+ */
+template <typename T>
+class MaybeVector {
+
+public:
+    typedef std::size_t size_type;
+    typedef std::uint64_t word_type;
+
+    static constexpr size_type wordBits = 64;
+
+    template <bool Const>
+    class Ref;
+
+    typedef Ref<false> reference;
+    typedef Ref<true> const_reference;
+
+    template <bool Const>
+    class Iterator;
+
+    typedef Iterator<false> iterator;
+    typedef Iterator<true> const_iterator;
+
+private:
+    typename Maybe_Detail::DenseValues<T>::type values;
+    std::vector<word_type> bits;
+
+    static size_type wordsFor(size_type n) {
+        return (n + wordBits - 1) / wordBits;
+    }
+
+    void setBit(size_type i) {
+        bits[i / wordBits] |= word_type(1) << (i % wordBits);
+    }
+
+    /*!
+     * Marks element i as empty, and drops whatever its T was holding on
+     * to if that is not free to keep around.
+     */
+    void clearSlot(size_type i) {
+        bits[i / wordBits] &= ~(word_type(1) << (i % wordBits));
+        if (!std::is_trivially_destructible<T>::value) {
+            values[i] = T();
+        }
+    }
+
+    void growBits() {
+        bits.resize(wordsFor(values.size()), 0);
+    }
+
+public:
+    /*!
+     * Constructs an empty vector
+     */
+    MaybeVector() {}
+
+    /*!
+     * Constructs a vector of n elements with no value
+     */
+    explicit MaybeVector(size_type n) : values(n), bits(wordsFor(n), 0) {}
+
+    /*!
+     * Constructs a vector holding copies of the given Maybes
+     */
+    MaybeVector(std::initializer_list<Maybe<T> > init) {
+        reserve(init.size());
+        for (const Maybe<T>& m : init) {
+            push_back(m);
+        }
+    }
+
+    size_type size() const {
+        return values.size();
+    }
+
+    bool empty() const {
+        return values.empty();
+    }
+
+    void reserve(size_type n) {
+        values.reserve(n);
+        bits.reserve(wordsFor(n));
+    }
+
+    void clear() {
+        values.clear();
+        bits.clear();
+    }
+
+    /*!
+     * Grows or shrinks to n elements. New elements have no value.
+     */
+    void resize(size_type n) {
+        while (values.size() > n) {
+            pop_back();
+        }
+        values.resize(n);
+        growBits();
+    }
+
+    /*!
+     * Appends an element holding value
+     */
+    void push_back(const T& value) {
+        emplace_back(value);
+    }
+
+    void push_back(T&& value) {
+        emplace_back(std::move(value));
+    }
+
+    /*!
+     * Appends an element with no value
+     */
+    void push_back(std::nullptr_t) {
+        values.emplace_back();
+        growBits();
+    }
+
+    /*!
+     * Appends a copy of a Maybe, with or without a value
+     */
+    template <typename Policy>
+    void push_back(const Maybe<T, Policy>& m) {
+        if (m) {
+            emplace_back(*m);
+        } else {
+            push_back(nullptr);
+        }
+    }
+
+    /*!
+     * Appends an element holding a T built from args
+     */
+    template <typename... Ts>
+    reference emplace_back(Ts&&... args) {
+        values.emplace_back(std::forward<Ts>(args)...);
+        growBits();
+        setBit(values.size() - 1);
+        return reference(this, values.size() - 1);
+    }
+
+    void pop_back() {
+        clearSlot(values.size() - 1);
+        values.pop_back();
+        bits.resize(wordsFor(values.size()));
+    }
+
+    /*!
+     * Checks if element i holds a value
+     */
+    bool has_value(size_type i) const {
+        return (bits[i / wordBits] >> (i % wordBits)) & 1;
+    }
+
+    reference operator[](size_type i) {
+        return reference(this, i);
+    }
+
+    const_reference operator[](size_type i) const {
+        return const_reference(this, i);
+    }
+
+    reference at(size_type i) {
+        if (i >= size()) throw std::out_of_range("MaybeVector index out of range");
+        return reference(this, i);
+    }
+
+    const_reference at(size_type i) const {
+        if (i >= size()) throw std::out_of_range("MaybeVector index out of range");
+        return const_reference(this, i);
+    }
+
+    /*!
+     * The dense value array. Entries without a value hold a default
+     * constructed T (or, for trivially destructible T, whatever was
+     * last stored there).
+     */
+    T* data() {
+        return values.data();
+    }
+
+    const T* data() const {
+        return values.data();
+    }
+
+    /*!
+     * The validity bitmap: bit i % 64 of word i / 64 is set when
+     * element i holds a value.
+     */
+    word_type* bitmap() {
+        return bits.data();
+    }
+
+    const word_type* bitmap() const {
+        return bits.data();
+    }
+
+    size_type bitmapWords() const {
+        return bits.size();
+    }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, size()); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    /*!
+     * A reference to one element, standing in for a Maybe<T>& (or a
+     * const Maybe<T>& when Const is true).
+     */
+    template <bool Const>
+    class Ref {
+
+        friend class MaybeVector;
+
+        typedef typename std::conditional<Const, const MaybeVector, MaybeVector>::type Vec;
+        typedef typename std::conditional<Const, const T, T>::type Value;
+
+        Vec* vec;
+        size_type index;
+
+        Ref(Vec* vec, size_type index) : vec(vec), index(index) {}
+
+    public:
+        typedef T maybe_proxy_of;
+
+        Ref(const Ref&) = default;
+
+        /*!
+         * A mutable reference can always be used as a const one
+         */
+        template <bool OtherConst, typename = typename std::enable_if<Const && !OtherConst>::type>
+        Ref(const Ref<OtherConst>& other) : vec(other.vec), index(other.index) {}
+
+        /*!
+         * Assigns the element other refers to, like assigning through
+         * a Maybe<T>&. It does not rebind this reference.
+         */
+        Ref& operator=(const Ref& other) {
+            return assignFrom(other);
+        }
+
+        template <bool OtherConst>
+        Ref& operator=(const Ref<OtherConst>& other) {
+            return assignFrom(other);
+        }
+
+        /*!
+         * Assigns from a Maybe, with or without a value
+         */
+        template <typename oT, typename oPolicy>
+        Ref& operator=(const Maybe<oT, oPolicy>& other) {
+            return assignFrom(other);
+        }
+
+        /*!
+         * Assigns a value, same as Maybe's operator=
+         */
+        template <typename O, typename = typename std::enable_if<
+            !Maybe_Detail::IsReservedArg<Ref, O>::value && !Maybe_Detail::IsMaybe<typename std::decay<O>::type>::value>::type>
+        Ref& operator=(O&& other) {
+            static_assert(!Const, "cannot assign through a const MaybeVector reference");
+            vec->values[index] = std::forward<O>(other);
+            vec->setBit(index);
+            return *this;
+        }
+
+        /*!
+         * Empties the element
+         */
+        Ref& operator=(std::nullptr_t) {
+            static_assert(!Const, "cannot assign through a const MaybeVector reference");
+            vec->clearSlot(index);
+            return *this;
+        }
+
+        /*!
+         * Checks if value can be extracted from this element
+         */
+        operator bool() const {
+            return vec->has_value(index);
+        }
+
+        /*!
+         * Extracts the value, and throws an exception if we can't
+         */
+        Value& operator()() const {
+            if (*this) return vec->values[index];
+            else Maybe_Detail::throwNullMaybe();
+        }
+
+        /*!
+         * Extracts the value without checking for it
+         */
+        Value& operator*() const noexcept {
+            assert(*this);
+            return vec->values[index];
+        }
+
+        Value* operator->() const noexcept {
+            assert(*this);
+            return &vec->values[index];
+        }
+
+        Value* get_if() const noexcept {
+            return *this ? &vec->values[index] : nullptr;
+        }
+
+        template <typename U>
+        T value_or(U&& def) const {
+            return *this ? vec->values[index] : static_cast<T>(std::forward<U>(def));
+        }
+
+        /*!
+         * Copies the element out into a Maybe
+         */
+        operator Maybe<T>() const {
+            return *this ? Maybe<T>(std::in_place, vec->values[index]) : Maybe<T>();
+        }
+
+        /*!
+         * Compares like Maybe::operator==, against any other Maybe proxy
+         */
+        template <typename R, typename = typename std::enable_if<Maybe_Detail::IsMaybeProxy<R>::value>::type>
+        bool operator==(const R& other) const {
+            return Maybe_Detail::equalMaybes<T, typename R::maybe_proxy_of>(*this, other);
+        }
+
+        template <typename R, typename = typename std::enable_if<Maybe_Detail::IsMaybeProxy<R>::value>::type>
+        bool operator!=(const R& other) const {
+            return !(*this == other);
+        }
+
+        template <typename oT, typename oPolicy>
+        friend bool operator==(const Ref& a, const Maybe<oT, oPolicy>& b) {
+            return Maybe_Detail::equalMaybes<T, oT>(a, b);
+        }
+
+        template <typename oT, typename oPolicy>
+        friend bool operator==(const Maybe<oT, oPolicy>& a, const Ref& b) {
+            return Maybe_Detail::equalMaybes<oT, T>(a, b);
+        }
+
+        template <typename oT, typename oPolicy>
+        friend bool operator!=(const Ref& a, const Maybe<oT, oPolicy>& b) {
+            return !(a == b);
+        }
+
+        template <typename oT, typename oPolicy>
+        friend bool operator!=(const Maybe<oT, oPolicy>& a, const Ref& b) {
+            return !(a == b);
+        }
+
+    private:
+        template <bool>
+        friend class Ref;
+
+        template <typename Other>
+        Ref& assignFrom(const Other& other) {
+            static_assert(!Const, "cannot assign through a const MaybeVector reference");
+            if (other) {
+                vec->values[index] = *other;
+                vec->setBit(index);
+            } else {
+                vec->clearSlot(index);
+            }
+            return *this;
+        }
+    };
+
+    /*!
+     * Random access iterator over the elements, yielding Refs
+     */
+    template <bool Const>
+    class Iterator {
+
+        friend class MaybeVector;
+
+        typedef typename std::conditional<Const, const MaybeVector, MaybeVector>::type Vec;
+
+        Vec* vec;
+        size_type index;
+
+        Iterator(Vec* vec, size_type index) : vec(vec), index(index) {}
+
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef Ref<Const> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef Ref<Const> reference;
+        typedef void pointer;
+
+        Iterator() : vec(nullptr), index(0) {}
+
+        template <bool OtherConst, typename = typename std::enable_if<Const && !OtherConst>::type>
+        Iterator(const Iterator<OtherConst>& other) : vec(other.vec), index(other.index) {}
+
+        reference operator*() const { return reference(vec, index); }
+        reference operator[](difference_type n) const { return reference(vec, index + n); }
+
+        /*!
+         * Position of this iterator in the vector
+         */
+        size_type position() const { return index; }
+
+        Iterator& operator++() { ++index; return *this; }
+        Iterator& operator--() { --index; return *this; }
+        Iterator operator++(int) { Iterator old = *this; ++index; return old; }
+        Iterator operator--(int) { Iterator old = *this; --index; return old; }
+        Iterator& operator+=(difference_type n) { index += n; return *this; }
+        Iterator& operator-=(difference_type n) { index -= n; return *this; }
+        Iterator operator+(difference_type n) const { return Iterator(vec, index + n); }
+        Iterator operator-(difference_type n) const { return Iterator(vec, index - n); }
+        friend Iterator operator+(difference_type n, const Iterator& it) { return it + n; }
+        difference_type operator-(const Iterator& other) const { return difference_type(index) - difference_type(other.index); }
+
+        bool operator==(const Iterator& other) const { return index == other.index; }
+        bool operator!=(const Iterator& other) const { return index != other.index; }
+        bool operator<(const Iterator& other) const { return index < other.index; }
+        bool operator>(const Iterator& other) const { return index > other.index; }
+        bool operator<=(const Iterator& other) const { return index <= other.index; }
+        bool operator>=(const Iterator& other) const { return index >= other.index; }
+
+    private:
+        template <bool>
+        friend class Iterator;
+    };
+};
+
+#endif
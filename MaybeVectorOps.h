@@ -0,0 +1,360 @@
+#ifndef MAYBE_VECTOR_OPS_H
+#define MAYBE_VECTOR_OPS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "MaybeVector.h"
+
+/*
+ * Bulk operations over whole MaybeVectors. They work a bitmap word (64
+ * elements) at a time. All-empty and all-full words take a shortcut,
+ * and mixed words run a branch-free loop.
+ *
+ * For arithmetic T the loops are compiled several times over on x86
+ * with GCC or Clang: once for the baseline target, once for AVX2 and
+ * once for AVX-512. The widest one the CPU supports is picked at run
+ * time. On AArch64, NEON is part of the baseline target, so the one
+ * generic build is already vectorized with it.
+ */
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define MAYBE_X86_DISPATCH 1
+#else
+#define MAYBE_X86_DISPATCH 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MAYBE_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define MAYBE_ALWAYS_INLINE inline
+#endif
+
+// GCC only vectorizes the cheapest loops at -O2, which leaves the
+// kernels scalar; Clang vectorizes them anyway.
+#if defined(__GNUC__) && !defined(__clang__)
+#define MAYBE_VECTORIZE __attribute__((optimize("tree-vectorize")))
+#else
+#define MAYBE_VECTORIZE
+#endif
+
+namespace MaybeVector_Detail
+{
+  typedef std::uint64_t word_type;
+
+  /*!
+   * Types the vectorized kernels handle: plain numbers and enums
+   */
+  using Maybe_Detail::IsPlain;
+
+  MAYBE_ALWAYS_INLINE std::size_t popcount(word_type w) {
+#if defined(__GNUC__) || defined(__clang__)
+      return __builtin_popcountll(w);
+#else
+      std::size_t count = 0;
+      for (; w != 0; w &= w - 1) ++count;
+      return count;
+#endif
+  }
+
+  /*!
+   * Index of the lowest set bit of a non-zero word
+   */
+  inline std::size_t lowestBit(word_type w) {
+#if defined(__GNUC__) || defined(__clang__)
+      return __builtin_ctzll(w);
+#else
+      std::size_t i = 0;
+      for (; !(w & 1); w >>= 1) ++i;
+      return i;
+#endif
+  }
+
+  enum class Isa { Generic, Avx2, Avx512 };
+
+  /*!
+   * The widest instruction set the kernels may use on this CPU
+   */
+  inline Isa detectIsa() {
+#if MAYBE_X86_DISPATCH
+      static const Isa isa = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") ? Isa::Avx512
+                           : __builtin_cpu_supports("avx2") ? Isa::Avx2
+                           : Isa::Generic;
+      return isa;
+#else
+      return Isa::Generic;
+#endif
+  }
+
+  /*!
+   * Mask of the bits in word w which belong to elements below n
+   */
+  inline word_type liveMask(std::size_t w, std::size_t n) {
+      std::size_t left = n - w * 64;
+      return left >= 64 ? ~word_type(0) : (word_type(1) << left) - 1;
+  }
+
+  MAYBE_ALWAYS_INLINE std::size_t countLoop(const word_type* bits, std::size_t words) {
+      std::size_t count = 0;
+      for (std::size_t w = 0; w < words; ++w) {
+          count += popcount(bits[w]);
+      }
+      return count;
+  }
+
+  /*!
+   * out[i] = element i of (values, bits) if it has a value, def otherwise
+   */
+  template <typename T>
+  MAYBE_ALWAYS_INLINE void valueOrLoop(const T* values, const word_type* bits, std::size_t n, T def, T* out) {
+      for (std::size_t base = 0; base < n; base += 64) {
+          std::size_t len = n - base < 64 ? n - base : 64;
+          word_type w = bits[base / 64];
+          if (w == 0) {
+              for (std::size_t i = 0; i < len; ++i) out[base + i] = def;
+          } else if (w == ~word_type(0)) {
+              std::memcpy(out + base, values + base, len * sizeof(T));
+          } else {
+              for (std::size_t i = 0; i < len; ++i) {
+                  out[base + i] = ((w >> i) & 1) ? values[base + i] : def;
+              }
+          }
+      }
+  }
+
+  /*!
+   * out[i] = a[i] where bitsA says a has a value, b[i] otherwise
+   */
+  template <typename T>
+  MAYBE_ALWAYS_INLINE void coalesceLoop(const T* a, const word_type* bitsA, const T* b, std::size_t n, T* out) {
+      for (std::size_t base = 0; base < n; base += 64) {
+          std::size_t len = n - base < 64 ? n - base : 64;
+          word_type w = bitsA[base / 64];
+          const T* from = w == 0 ? b : a;
+          if (w == 0 || w == ~word_type(0)) {
+              std::memcpy(out + base, from + base, len * sizeof(T));
+          } else {
+              for (std::size_t i = 0; i < len; ++i) {
+                  out[base + i] = ((w >> i) & 1) ? a[base + i] : b[base + i];
+              }
+          }
+      }
+  }
+
+  /*!
+   * One result bit per element, set where a[i] == b[i]. Bits for
+   * elements without a value on both sides are masked off by the caller.
+   */
+  template <typename T, typename oT>
+  MAYBE_ALWAYS_INLINE void equalLoop(const T* a, const oT* b, const word_type* both, std::size_t n, word_type* out) {
+      for (std::size_t base = 0; base < n; base += 64) {
+          std::size_t len = n - base < 64 ? n - base : 64;
+          word_type w = 0;
+          if (both[base / 64] != 0) {
+              // compare into bytes first so the comparisons vectorize,
+              // then pack them down to bits
+              unsigned char eq[64];
+              for (std::size_t i = 0; i < len; ++i) {
+                  eq[i] = a[base + i] == b[base + i];
+              }
+              for (std::size_t i = 0; i < len; ++i) {
+                  w |= word_type(eq[i]) << i;
+              }
+          }
+          out[base / 64] = w;
+      }
+  }
+
+#if MAYBE_X86_DISPATCH
+  __attribute__((target("popcnt"))) inline std::size_t countPopcnt(const word_type* bits, std::size_t words) {
+      return countLoop(bits, words);
+  }
+
+  template <typename T>
+  __attribute__((target("avx2"))) MAYBE_VECTORIZE void valueOrAvx2(const T* values, const word_type* bits, std::size_t n, T def, T* out) {
+      valueOrLoop(values, bits, n, def, out);
+  }
+
+  template <typename T>
+  __attribute__((target("avx512f,avx512bw"))) MAYBE_VECTORIZE void valueOrAvx512(const T* values, const word_type* bits, std::size_t n, T def, T* out) {
+      valueOrLoop(values, bits, n, def, out);
+  }
+
+  template <typename T>
+  __attribute__((target("avx2"))) MAYBE_VECTORIZE void coalesceAvx2(const T* a, const word_type* bitsA, const T* b, std::size_t n, T* out) {
+      coalesceLoop(a, bitsA, b, n, out);
+  }
+
+  template <typename T>
+  __attribute__((target("avx512f,avx512bw"))) MAYBE_VECTORIZE void coalesceAvx512(const T* a, const word_type* bitsA, const T* b, std::size_t n, T* out) {
+      coalesceLoop(a, bitsA, b, n, out);
+  }
+
+  template <typename T, typename oT>
+  __attribute__((target("avx2"))) MAYBE_VECTORIZE void equalAvx2(const T* a, const oT* b, const word_type* both, std::size_t n, word_type* out) {
+      equalLoop(a, b, both, n, out);
+  }
+
+  template <typename T, typename oT>
+  __attribute__((target("avx512f,avx512bw"))) MAYBE_VECTORIZE void equalAvx512(const T* a, const oT* b, const word_type* both, std::size_t n, word_type* out) {
+      equalLoop(a, b, both, n, out);
+  }
+#endif
+
+  template <typename T>
+  void valueOr(const T* values, const word_type* bits, std::size_t n, T def, T* out) {
+#if MAYBE_X86_DISPATCH
+      switch (detectIsa()) {
+      case Isa::Avx512: return valueOrAvx512(values, bits, n, def, out);
+      case Isa::Avx2: return valueOrAvx2(values, bits, n, def, out);
+      case Isa::Generic: break;
+      }
+#endif
+      valueOrLoop(values, bits, n, def, out);
+  }
+
+  template <typename T>
+  void coalesce(const T* a, const word_type* bitsA, const T* b, std::size_t n, T* out) {
+#if MAYBE_X86_DISPATCH
+      switch (detectIsa()) {
+      case Isa::Avx512: return coalesceAvx512(a, bitsA, b, n, out);
+      case Isa::Avx2: return coalesceAvx2(a, bitsA, b, n, out);
+      case Isa::Generic: break;
+      }
+#endif
+      coalesceLoop(a, bitsA, b, n, out);
+  }
+
+  template <typename T, typename oT>
+  void equal(const T* a, const oT* b, const word_type* both, std::size_t n, word_type* out) {
+#if MAYBE_X86_DISPATCH
+      switch (detectIsa()) {
+      case Isa::Avx512: return equalAvx512(a, b, both, n, out);
+      case Isa::Avx2: return equalAvx2(a, b, both, n, out);
+      case Isa::Generic: break;
+      }
+#endif
+      equalLoop(a, b, both, n, out);
+  }
+
+  inline void checkSizes(std::size_t a, std::size_t b) {
+      if (a != b) throw std::invalid_argument("MaybeVectors must be the same size");
+  }
+}
+
+/*!
+ * Counts the elements which hold a value
+ */
+template <typename T>
+std::size_t maybe_count_engaged(const MaybeVector<T>& v) {
+#if MAYBE_X86_DISPATCH
+    if (__builtin_cpu_supports("popcnt")) {
+        return MaybeVector_Detail::countPopcnt(v.bitmap(), v.bitmapWords());
+    }
+#endif
+    return MaybeVector_Detail::countLoop(v.bitmap(), v.bitmapWords());
+}
+
+/*!
+ * Writes every element's value to out, or def for elements without
+ * one. out must have room for v.size() elements.
+ */
+template <typename T>
+void maybe_value_or(const MaybeVector<T>& v, const T& def, T* out) {
+    if constexpr (MaybeVector_Detail::IsPlain<T>::value) {
+        MaybeVector_Detail::valueOr(v.data(), v.bitmap(), v.size(), def, out);
+    } else {
+        for (std::size_t i = 0; i < v.size(); ++i) {
+            out[i] = v.has_value(i) ? v.data()[i] : def;
+        }
+    }
+}
+
+/*!
+ * Returns every element's value, or def for elements without one
+ */
+template <typename T>
+std::vector<T> maybe_value_or(const MaybeVector<T>& v, const T& def) {
+    std::vector<T> out(v.size());
+    if constexpr (std::is_same<T, bool>::value) {
+        // std::vector<bool> has no data() to write through
+        for (std::size_t i = 0; i < v.size(); ++i) {
+            out[i] = v.has_value(i) ? v.data()[i] : def;
+        }
+    } else {
+        maybe_value_or(v, def, out.data());
+    }
+    return out;
+}
+
+/*!
+ * Elementwise a, falling back to b where a has no value. The result
+ * only lacks a value where both a and b do.
+ */
+template <typename T>
+MaybeVector<T> maybe_coalesce(const MaybeVector<T>& a, const MaybeVector<T>& b) {
+    MaybeVector_Detail::checkSizes(a.size(), b.size());
+
+    MaybeVector<T> out(a.size());
+    if constexpr (MaybeVector_Detail::IsPlain<T>::value) {
+        MaybeVector_Detail::coalesce(a.data(), a.bitmap(), b.data(), a.size(), out.data());
+        for (std::size_t w = 0; w < out.bitmapWords(); ++w) {
+            out.bitmap()[w] = a.bitmap()[w] | b.bitmap()[w];
+        }
+    } else {
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            out[i] = a[i] ? a[i] : b[i];
+        }
+    }
+    return out;
+}
+
+/*!
+ * Compares a and b elementwise with the same truth table as
+ * Maybe::operator==, returning a bitmap laid out like
+ * MaybeVector::bitmap() with a bit set for every equal pair.
+ */
+template <typename T, typename oT>
+std::vector<std::uint64_t> maybe_equal(const MaybeVector<T>& a, const MaybeVector<oT>& b) {
+    typedef MaybeVector_Detail::word_type word_type;
+    MaybeVector_Detail::checkSizes(a.size(), b.size());
+
+    std::size_t words = a.bitmapWords();
+    std::vector<word_type> out(words);
+    const bool sameType = std::is_same<T, oT>::value;
+
+    std::vector<word_type> both(words);
+    for (std::size_t w = 0; w < words; ++w) {
+        both[w] = a.bitmap()[w] & b.bitmap()[w];
+    }
+
+    if constexpr (MaybeVector_Detail::IsPlain<T>::value && MaybeVector_Detail::IsPlain<oT>::value &&
+                  Maybe_Tests::EqualExists<T, oT>::value) {
+        MaybeVector_Detail::equal(a.data(), b.data(), both.data(), a.size(), out.data());
+        for (std::size_t w = 0; w < words; ++w) {
+            out[w] &= both[w];
+        }
+    } else {
+        for (std::size_t w = 0; w < words; ++w) {
+            for (word_type m = both[w]; m != 0; m &= m - 1) {
+                std::size_t i = w * 64 + MaybeVector_Detail::lowestBit(m);
+                if (Maybe_Detail::doEqualComparison<T, oT>(a.data()[i], b.data()[i])) {
+                    out[w] |= word_type(1) << (i % 64);
+                }
+            }
+        }
+    }
+
+    if (sameType) {
+        for (std::size_t w = 0; w < words; ++w) {
+            out[w] |= ~(a.bitmap()[w] | b.bitmap()[w]) & MaybeVector_Detail::liveMask(w, a.size());
+        }
+    }
+    return out;
+}
+
+#endif
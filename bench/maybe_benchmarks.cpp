@@ -0,0 +1,480 @@
+/*
+ * Google Benchmark suite for Maybe's public operations: construction
+ * from a value, copy and move construction, the three kinds of
+ * assignment (another Maybe, a value and nullptr), operator== and
+ * operator()(). Each one runs for a small, a medium and a large payload,
+ * with inline and boxed storage, next to std::optional and a plain
+ * owning pointer doing the same work.
+ *
+ * VectorGrowth fills a std::vector<Maybe<std::string> > one element at
+ * a time up to 10M elements, next to a Maybe whose move constructor may
+ * throw, which std::vector copies rather than moves when it grows.
+ *
+ * AssignLoop assigns a run of strings or vectors of different lengths
+ * into one Maybe, once onto its existing value and once emptying it
+ * first, the destroy-and-reconstruct that assignment used to do. Its
+ * capacity counter is what the target was left holding.
+ *
+ * Chain runs five steps of map and and_then over a column of Maybes,
+ * next to the same steps written out as nested branches; the two should
+ * take the same time.
+ *
+ *     maybe_benchmarks --benchmark_out=maybe.json --benchmark_out_format=json
+ *
+ * The bench_json target runs it that way.
+ */
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "Maybe.h"
+
+namespace
+{
+  typedef int Small;
+  typedef std::string Medium;                     //too long for the small string buffer
+  typedef std::array<std::uint64_t, 128> Large;   //1KB
+
+  template <typename T>
+  T sample(unsigned seed);
+
+  template <>
+  Small sample<Small>(unsigned seed) {
+      return int(seed);
+  }
+
+  template <>
+  Medium sample<Medium>(unsigned seed) {
+      return Medium(48, char('a' + seed % 26));
+  }
+
+  template <>
+  Large sample<Large>(unsigned seed) {
+      Large l;
+      l.fill(seed);
+      return l;
+  }
+
+  /*!
+   * What a Maybe replaces: a pointer to a heap value, or null. It
+   * copies deeply so it can stand in for a boxed Maybe in every
+   * benchmark.
+   */
+  template <typename T>
+  class OwningPtr {
+
+      T* p;
+
+  public:
+      OwningPtr() : p(nullptr) {}
+      OwningPtr(const T& v) : p(new T(v)) {}
+      OwningPtr(const OwningPtr& other) : p(other.p != nullptr ? new T(*other.p) : nullptr) {}
+      OwningPtr(OwningPtr&& other) noexcept : p(other.p) { other.p = nullptr; }
+      ~OwningPtr() { delete p; }
+
+      OwningPtr& operator=(const OwningPtr& other) {
+          if (other.p == nullptr) {
+              *this = nullptr;
+          } else if (p != nullptr) {
+              *p = *other.p;
+          } else {
+              p = new T(*other.p);
+          }
+          return *this;
+      }
+
+      OwningPtr& operator=(OwningPtr&& other) noexcept {
+          std::swap(p, other.p);
+          return *this;
+      }
+
+      OwningPtr& operator=(const T& v) {
+          if (p != nullptr) {
+              *p = v;
+          } else {
+              p = new T(v);
+          }
+          return *this;
+      }
+
+      OwningPtr& operator=(std::nullptr_t) {
+          delete p;
+          p = nullptr;
+          return *this;
+      }
+
+      bool operator==(const OwningPtr& other) const {
+          return p != nullptr && other.p != nullptr ? *p == *other.p : p == other.p;
+      }
+
+      T& get() {
+          if (p == nullptr) {
+              throw null_maybe_exception();
+          }
+          return *p;
+      }
+  };
+
+  /*!
+   * The checked access and emptying of each kind of holder
+   */
+  template <typename T, typename Policy>
+  T& access(Maybe<T, Policy>& m) {
+      return m();
+  }
+
+  template <typename T>
+  T& access(std::optional<T>& o) {
+      return o.value();
+  }
+
+  template <typename T>
+  T& access(OwningPtr<T>& p) {
+      return p.get();
+  }
+
+  template <typename T, typename Policy>
+  void clear(Maybe<T, Policy>& m) {
+      m = nullptr;
+  }
+
+  template <typename T>
+  void clear(std::optional<T>& o) {
+      o = std::nullopt;
+  }
+
+  template <typename T>
+  void clear(OwningPtr<T>& p) {
+      p = nullptr;
+  }
+
+  template <typename H>
+  struct ValueOf;
+
+  template <typename T, typename Policy>
+  struct ValueOf<Maybe<T, Policy> > { typedef T type; };
+
+  template <typename T>
+  struct ValueOf<std::optional<T> > { typedef T type; };
+
+  template <typename T>
+  struct ValueOf<OwningPtr<T> > { typedef T type; };
+
+  template <typename H>
+  void Construct(benchmark::State& state) {
+      typename ValueOf<H>::type v = sample<typename ValueOf<H>::type>(1);
+      for (auto _ : state) {
+          H h(v);
+          benchmark::DoNotOptimize(h);
+      }
+  }
+
+  template <typename H>
+  void CopyConstruct(benchmark::State& state) {
+      H a(sample<typename ValueOf<H>::type>(1));
+      for (auto _ : state) {
+          H b(a);
+          benchmark::DoNotOptimize(b);
+      }
+  }
+
+  /*!
+   * Moves the value out and back again each iteration, so there is
+   * always something to move: one move construction and one move
+   * assignment
+   */
+  template <typename H>
+  void MoveConstruct(benchmark::State& state) {
+      H a(sample<typename ValueOf<H>::type>(1));
+      for (auto _ : state) {
+          H b(std::move(a));
+          benchmark::DoNotOptimize(b);
+          a = std::move(b);
+      }
+  }
+
+  template <typename H>
+  void CopyAssign(benchmark::State& state) {
+      H a(sample<typename ValueOf<H>::type>(1));
+      H b(sample<typename ValueOf<H>::type>(2));
+      for (auto _ : state) {
+          b = a;
+          benchmark::DoNotOptimize(b);
+      }
+  }
+
+  template <typename H>
+  void ValueAssign(benchmark::State& state) {
+      typename ValueOf<H>::type v = sample<typename ValueOf<H>::type>(1);
+      H h(sample<typename ValueOf<H>::type>(2));
+      for (auto _ : state) {
+          h = v;
+          benchmark::DoNotOptimize(h);
+      }
+  }
+
+  /*!
+   * Empties a holder and fills it again, so each nullptr assignment has
+   * a value to drop
+   */
+  template <typename H>
+  void NullAssign(benchmark::State& state) {
+      typename ValueOf<H>::type v = sample<typename ValueOf<H>::type>(1);
+      H h(v);
+      for (auto _ : state) {
+          clear(h);
+          benchmark::DoNotOptimize(h);
+          h = v;
+      }
+  }
+
+  template <typename H>
+  void Equal(benchmark::State& state) {
+      H a(sample<typename ValueOf<H>::type>(1));
+      H b(sample<typename ValueOf<H>::type>(1));
+      for (auto _ : state) {
+          benchmark::DoNotOptimize(a == b);
+      }
+  }
+
+  template <typename H>
+  void Access(benchmark::State& state) {
+      H h(sample<typename ValueOf<H>::type>(1));
+      for (auto _ : state) {
+          benchmark::DoNotOptimize(access(h));
+      }
+  }
+
+  typedef Maybe<Small> InlineSmall;
+  typedef Maybe<Medium> InlineMedium;
+  typedef Maybe<Large> InlineLarge;
+  typedef Maybe<Small, MaybeBoxed<> > BoxedSmall;
+  typedef Maybe<Medium, MaybeBoxed<> > BoxedMedium;
+  typedef Maybe<Large, MaybeBoxed<> > BoxedLarge;
+  typedef std::optional<Small> OptionalSmall;
+  typedef std::optional<Medium> OptionalMedium;
+  typedef std::optional<Large> OptionalLarge;
+  typedef OwningPtr<Small> PointerSmall;
+  typedef OwningPtr<Medium> PointerMedium;
+  typedef OwningPtr<Large> PointerLarge;
+
+  /*!
+   * A Maybe whose move constructor isn't noexcept, as Maybe's were not
+   * before they were made conditionally noexcept. std::vector can't
+   * move these when it reallocates, since a throw part way through
+   * would lose elements, so it copies each of them instead.
+   */
+  template <typename M>
+  struct ThrowingMove {
+      M m;
+
+      template <typename V>
+      explicit ThrowingMove(V&& v) : m(std::forward<V>(v)) {}
+
+      ThrowingMove(const ThrowingMove&) = default;
+      ThrowingMove(ThrowingMove&& other) noexcept(false) : m(std::move(other.m)) {}
+  };
+
+  template <typename M>
+  struct ValueOf<ThrowingMove<M> > : ValueOf<M> {};
+
+  /*!
+   * Grows a vector to state.range(0) elements with push_back, so it
+   * reallocates about log2(n) times. The values are made before timing
+   * starts, so only the growth is measured.
+   */
+  template <typename H>
+  void VectorGrowth(benchmark::State& state) {
+      std::size_t n = static_cast<std::size_t>(state.range(0));
+      typename ValueOf<H>::type v = sample<typename ValueOf<H>::type>(1);
+      for (auto _ : state) {
+          std::vector<H> grown;
+          for (std::size_t i = 0; i < n; ++i) {
+              grown.push_back(H(v));
+          }
+          benchmark::DoNotOptimize(grown.data());
+          benchmark::ClobberMemory();
+      }
+      state.SetItemsProcessed(state.iterations() * state.range(0));
+  }
+
+  static_assert(std::is_nothrow_move_constructible<InlineMedium>::value, "VectorGrowth compares against a nothrow move");
+  static_assert(!std::is_nothrow_move_constructible<ThrowingMove<InlineMedium> >::value, "ThrowingMove should not be nothrow");
+
+  typedef ThrowingMove<InlineMedium> ThrowingInlineMedium;
+  typedef ThrowingMove<BoxedMedium> ThrowingBoxedMedium;
+
+  /*!
+   * A payload of about n elements; the lengths are what matter to
+   * assignment, not the contents
+   */
+  template <typename T>
+  T sized(std::size_t n);
+
+  template <>
+  std::string sized<std::string>(std::size_t n) {
+      return std::string(n, 'x');
+  }
+
+  template <>
+  std::vector<int> sized<std::vector<int> >(std::size_t n) {
+      return std::vector<int>(n, 1);
+  }
+
+  /*!
+   * Assigns each of 64 engaged Maybes, of lengths between 32 and 536 in
+   * no particular order, to the same target. Assigned in place, the
+   * target keeps the largest buffer it has been given and stops
+   * allocating; with Reconstruct, the target is emptied before each
+   * assignment, so every one of them allocates a buffer of its own.
+   */
+  template <typename M, bool Reconstruct>
+  void AssignLoop(benchmark::State& state) {
+      typedef typename ValueOf<M>::type T;
+
+      std::vector<M> sources;
+      for (std::size_t i = 0; i < 64; ++i) {
+          sources.emplace_back(sized<T>(32 + (i * 37) % 64 * 8));
+      }
+      M target(sources[0]);
+      for (auto _ : state) {
+          for (const M& source : sources) {
+              if (Reconstruct) {
+                  target = nullptr;
+              }
+              target = source;
+          }
+          benchmark::DoNotOptimize(target);
+      }
+      state.SetItemsProcessed(state.iterations() * std::int64_t(sources.size()));
+      state.counters["capacity"] = double(target().capacity());
+  }
+
+  typedef Maybe<std::vector<int> > InlineVector;
+  typedef Maybe<std::vector<int>, MaybeBoxed<> > BoxedVector;
+
+  /*!
+   * The five steps of Chain: three which always give a value, and two
+   * which sometimes don't
+   */
+  inline int bump(int x) { return x + 1; }
+  inline Maybe<int> unlessSeventh(int x) { return x % 7 != 0 ? Maybe<int>(x * 3) : Maybe<int>(); }
+  inline int lower(int x) { return x - 2; }
+  inline Maybe<int> halvePositive(int x) { return x > 0 ? Maybe<int>(x / 2) : Maybe<int>(); }
+  inline int scramble(int x) { return x ^ 0x55; }
+
+  /*!
+   * Both versions are kept out of line, so that they are compared as
+   * compiled functions; left to itself the compiler inlines one into the
+   * loop and not the other, and the benchmark measures that instead.
+   */
+#if defined(_MSC_VER)
+#define MAYBE_BENCHMARK_NOINLINE __declspec(noinline)
+#else
+#define MAYBE_BENCHMARK_NOINLINE __attribute__((noinline))
+#endif
+
+  MAYBE_BENCHMARK_NOINLINE Maybe<int> chained(const Maybe<int>& m) {
+      return m.map(bump).and_then(unlessSeventh).map(lower).and_then(halvePositive).map(scramble);
+  }
+
+  /*!
+   * chained(), as it would be written without map and and_then
+   */
+  MAYBE_BENCHMARK_NOINLINE Maybe<int> branched(const Maybe<int>& m) {
+      if (m) {
+          int a = bump(*m);
+          Maybe<int> b = unlessSeventh(a);
+          if (b) {
+              int c = lower(*b);
+              Maybe<int> d = halvePositive(c);
+              if (d) {
+                  return Maybe<int>(scramble(*d));
+              }
+          }
+      }
+      return Maybe<int>();
+  }
+
+  /*!
+   * Runs one of the two over 1024 inputs, a fifth of them empty and some
+   * negative, summing the results
+   */
+  template <Maybe<int> (*Steps)(const Maybe<int>&)>
+  void Chain(benchmark::State& state) {
+      std::vector<Maybe<int> > inputs;
+      for (int i = 0; i < 1024; ++i) {
+          inputs.push_back(i % 5 == 0 ? Maybe<int>() : Maybe<int>(i * 7919 % 2001 - 500));
+      }
+      for (const Maybe<int>& m : inputs) {
+          if (chained(m) != branched(m)) {
+              state.SkipWithError("chained and branched steps disagree");
+              return;
+          }
+      }
+
+      for (auto _ : state) {
+          long sum = 0;
+          for (const Maybe<int>& m : inputs) {
+              benchmark::DoNotOptimize(m);
+              sum += Steps(m).value_or(0);
+          }
+          benchmark::DoNotOptimize(sum);
+      }
+      state.SetItemsProcessed(state.iterations() * std::int64_t(inputs.size()));
+  }
+}
+
+#define MAYBE_BENCHMARK_ALL(H)              \
+    BENCHMARK_TEMPLATE(Construct, H);       \
+    BENCHMARK_TEMPLATE(CopyConstruct, H);   \
+    BENCHMARK_TEMPLATE(MoveConstruct, H);   \
+    BENCHMARK_TEMPLATE(CopyAssign, H);      \
+    BENCHMARK_TEMPLATE(ValueAssign, H);     \
+    BENCHMARK_TEMPLATE(NullAssign, H);      \
+    BENCHMARK_TEMPLATE(Equal, H);           \
+    BENCHMARK_TEMPLATE(Access, H)
+
+MAYBE_BENCHMARK_ALL(InlineSmall);
+MAYBE_BENCHMARK_ALL(BoxedSmall);
+MAYBE_BENCHMARK_ALL(OptionalSmall);
+MAYBE_BENCHMARK_ALL(PointerSmall);
+
+MAYBE_BENCHMARK_ALL(InlineMedium);
+MAYBE_BENCHMARK_ALL(BoxedMedium);
+MAYBE_BENCHMARK_ALL(OptionalMedium);
+MAYBE_BENCHMARK_ALL(PointerMedium);
+
+MAYBE_BENCHMARK_ALL(InlineLarge);
+MAYBE_BENCHMARK_ALL(BoxedLarge);
+MAYBE_BENCHMARK_ALL(OptionalLarge);
+MAYBE_BENCHMARK_ALL(PointerLarge);
+
+#define MAYBE_BENCHMARK_GROWTH(H) \
+    BENCHMARK_TEMPLATE(VectorGrowth, H)->Arg(10000000)->Unit(benchmark::kMillisecond)
+
+MAYBE_BENCHMARK_GROWTH(InlineMedium);
+MAYBE_BENCHMARK_GROWTH(ThrowingInlineMedium);
+MAYBE_BENCHMARK_GROWTH(BoxedMedium);
+MAYBE_BENCHMARK_GROWTH(ThrowingBoxedMedium);
+MAYBE_BENCHMARK_GROWTH(OptionalMedium);
+
+#define MAYBE_BENCHMARK_ASSIGN_LOOP(M)            \
+    BENCHMARK_TEMPLATE(AssignLoop, M, false);     \
+    BENCHMARK_TEMPLATE(AssignLoop, M, true)
+
+MAYBE_BENCHMARK_ASSIGN_LOOP(InlineMedium);
+MAYBE_BENCHMARK_ASSIGN_LOOP(BoxedMedium);
+MAYBE_BENCHMARK_ASSIGN_LOOP(InlineVector);
+MAYBE_BENCHMARK_ASSIGN_LOOP(BoxedVector);
+
+BENCHMARK_TEMPLATE(Chain, chained);
+BENCHMARK_TEMPLATE(Chain, branched);
+
+BENCHMARK_MAIN();
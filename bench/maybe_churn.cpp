@@ -0,0 +1,128 @@
+/*
+ * Assignment churn for boxed Maybes, counting every byte that goes
+ * through their allocator. It runs each way a Maybe can gain, replace or
+ * lose its value for a number of iterations, then reports how many bytes
+ * were allocated and how many are still live once every Maybe is gone.
+ * Anything still live is a leak, and makes it exit with an error.
+ *
+ *     maybe_churn [iterations]
+ */
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+
+#include "Maybe.h"
+
+namespace
+{
+  struct Counts {
+      std::size_t allocations;
+      std::size_t deallocations;
+      std::size_t bytesAllocated;
+      std::size_t bytesFreed;
+      std::size_t peakLive;
+  };
+
+  Counts counts;
+
+  /*!
+   * std::allocator, plus a tally of what goes through it
+   */
+  template <typename T>
+  struct CountingAllocator {
+      typedef T value_type;
+
+      CountingAllocator() = default;
+
+      template <typename U>
+      CountingAllocator(const CountingAllocator<U>&) {}
+
+      T* allocate(std::size_t n) {
+          counts.allocations += 1;
+          counts.bytesAllocated += n * sizeof(T);
+          std::size_t live = counts.bytesAllocated - counts.bytesFreed;
+          if (live > counts.peakLive) {
+              counts.peakLive = live;
+          }
+          return std::allocator<T>().allocate(n);
+      }
+
+      void deallocate(T* p, std::size_t n) {
+          counts.deallocations += 1;
+          counts.bytesFreed += n * sizeof(T);
+          std::allocator<T>().deallocate(p, n);
+      }
+
+      template <typename U>
+      bool operator==(const CountingAllocator<U>&) const { return true; }
+
+      template <typename U>
+      bool operator!=(const CountingAllocator<U>&) const { return false; }
+  };
+
+  /*!
+   * A payload which owns memory of its own, so a value that is
+   * destroyed but never deallocated (or the other way round) shows up
+   */
+  struct Payload {
+      std::string text;
+      long id;
+
+      explicit Payload(long id) : text(48, char('a' + id % 26)), id(id) {}
+  };
+
+  typedef Maybe<Payload, MaybeBoxed<CountingAllocator<void> > > Boxed;
+
+  /*!
+   * One round of every operation that can allocate or free a value
+   */
+  void churn(long i, Boxed& kept) {
+      Boxed a(Payload{i});
+      Boxed b = a;                        //copy construct
+      Boxed c;
+
+      c = a;                              //copy assign into empty
+      c = b;                              //copy assign over a value
+      c = std::move(b);                   //move assign over a value
+      b = std::move(c);                   //move assign into empty
+      a = nullptr;                        //assign nullptr
+      a = Payload{i + 1};                 //assign a value into empty
+      a = Payload{i + 2};                 //assign a value over a value
+      a.emplace(i + 3);                   //emplace over a value
+      swap(a, c);                         //swap with an empty one
+      c = Boxed();                        //move assign an empty one
+      kept = (i % 3 == 0) ? Boxed() : b;  //leave the outer Maybe in either state
+      Boxed moved(std::move(kept));       //move construct
+      kept = std::move(moved);
+  }
+}
+
+int main(int argc, char** argv) {
+    long iterations = argc > 1 ? std::atol(argv[1]) : 1000000;
+
+    {
+        Boxed kept;
+        for (long i = 0; i < iterations; ++i) {
+            churn(i, kept);
+        }
+    }
+
+    std::size_t live = counts.bytesAllocated - counts.bytesFreed;
+
+    std::printf("iterations:      %ld\n", iterations);
+    std::printf("allocations:     %zu\n", counts.allocations);
+    std::printf("deallocations:   %zu\n", counts.deallocations);
+    std::printf("bytes allocated: %zu\n", counts.bytesAllocated);
+    std::printf("bytes freed:     %zu\n", counts.bytesFreed);
+    std::printf("peak bytes live: %zu\n", counts.peakLive);
+    std::printf("bytes live:      %zu\n", live);
+
+    if (live != 0 || counts.allocations != counts.deallocations) {
+        std::fprintf(stderr, "maybe_churn: %zu bytes leaked\n", live);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,90 @@
+/*
+ * A compile-time benchmark: instantiates Maybe over a few hundred
+ * generated payload types, comparing each with itself and with a bare
+ * value, so that most of the time spent compiling it goes on Maybe's
+ * templates and the EqualExists trait. Nothing in it runs.
+ *
+ *     time cmake --build . --target maybe_compile_time --clean-first
+ *
+ * times it; adding -ftime-report to the flags shows where it goes. It is
+ * built as C++17, where EqualExists is the void_t detection idiom, and as
+ * C++20 (maybe_compile_time_cxx20), where it is a concept.
+ * MAYBE_COMPILE_TYPES sets how many types are generated.
+ */
+
+#include <cstddef>
+#include <utility>
+
+#include "Maybe.h"
+
+#ifndef MAYBE_COMPILE_TYPES
+#define MAYBE_COMPILE_TYPES 300
+#endif
+
+namespace
+{
+  /*!
+   * Payload N. Two thirds of them have an operator==, and of those half
+   * also compare against a bare int, so every way EqualExists can come
+   * out is exercised.
+   */
+  template <std::size_t N, int Kind = N % 3>
+  struct Payload {
+      int v;
+  };
+
+  template <std::size_t N>
+  struct Payload<N, 1> {
+      int v;
+
+      bool operator==(const Payload& other) const { return v == other.v; }
+  };
+
+  template <std::size_t N>
+  struct Payload<N, 2> {
+      int v;
+
+      bool operator==(const Payload& other) const { return v == other.v; }
+      bool operator==(int other) const { return v == other; }
+  };
+
+  template <std::size_t N>
+  bool operator==(int a, const Payload<N, 2>& b) {
+      return b == a;
+  }
+
+  /*!
+   * What a typical translation unit does with a Maybe of a payload type
+   */
+  template <std::size_t N>
+  int use() {
+      typedef Payload<N> P;
+
+      Maybe<P> a(P{int(N)});
+      Maybe<P> b;
+      b = a;
+      Maybe<P, MaybeBoxed<> > boxed(a);
+      int n = a ? a().v : 0;
+      n += b.value_or(P{0}).v;
+      n += a.map([](const P& p) { return p.v; }).value_or(0);
+
+      if constexpr (Maybe_Tests::EqualExists<P>::value) {
+          n += a == b;
+          n += a != boxed;
+      }
+      if constexpr (Maybe_Tests::EqualExists<P, int>::value) {
+          n += a == 3;
+          n += 3 != b;
+      }
+      return n;
+  }
+
+  template <std::size_t... Ns>
+  int useAll(std::index_sequence<Ns...>) {
+      return (use<Ns>() + ...);
+  }
+}
+
+int maybe_compile_time() {
+    return useAll(std::make_index_sequence<MAYBE_COMPILE_TYPES>());
+}
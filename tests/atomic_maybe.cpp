@@ -0,0 +1,133 @@
+/*
+ * Checks each AtomicMaybe layout: single threaded behaviour, then
+ * producers and consumers handing values through one slot, counting
+ * that every value arrives exactly once.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AtomicMaybe.h"
+
+namespace
+{
+  int failures = 0;
+
+  void check(bool ok, const char* what) {
+      if (!ok) {
+          std::fprintf(stderr, "FAILED: %s\n", what);
+          ++failures;
+      }
+  }
+
+  //all of the types in the table
+  static_assert(Maybe_Detail::AtomicLayoutOf<int>::value == Maybe_Detail::AtomicFlagged, "int is flagged");
+  static_assert(Maybe_Detail::AtomicLayoutOf<int*>::value == Maybe_Detail::AtomicNiche, "a pointer uses its niche");
+  static_assert(Maybe_Detail::AtomicLayoutOf<long long>::value ==
+                (MAYBE_ATOMIC_WIDE ? Maybe_Detail::AtomicWide : Maybe_Detail::AtomicBoxed),
+                "an 8 byte integer takes a pair of words where it can");
+  static_assert(Maybe_Detail::AtomicLayoutOf<std::string>::value == Maybe_Detail::AtomicBoxed, "a string is boxed");
+  static_assert(AtomicMaybe<int*>::is_always_lock_free, "a niche slot is lock free");
+
+  int cells[4001];
+
+  template <typename T>
+  T make(int i) {
+      if constexpr (std::is_pointer<T>::value) {
+          return &cells[i];
+      } else if constexpr (std::is_same<T, std::string>::value) {
+          return std::to_string(i);
+      } else {
+          return T(i);
+      }
+  }
+
+  template <typename T>
+  void single(T a, T b) {
+      AtomicMaybe<T> slot;
+      check(!slot.load(), "a new slot is empty");
+
+      slot.store(Maybe<T>(a));
+      check(slot.load() && *slot.load() == a, "load returns what was stored");
+
+      Maybe<T> old = slot.exchange(Maybe<T>(b));
+      check(old && *old == a, "exchange returns the old contents");
+
+      Maybe<T> expected(a);
+      check(!slot.compare_exchange(expected, Maybe<T>(a)), "compare_exchange fails on a mismatch");
+      check(expected && *expected == b, "and loads the current contents");
+      check(slot.compare_exchange(expected, Maybe<T>()) && !slot.load(), "compare_exchange can empty the slot");
+
+      Maybe<T> none;
+      check(slot.compare_exchange(none, Maybe<T>(a)), "compare_exchange can fill an empty slot");
+      Maybe<T> taken = slot.take();
+      check(taken && *taken == a && !slot.take(), "take empties the slot");
+  }
+
+  //two producers each put 1..per into the slot once it is empty, and
+  //two consumers take them out
+  template <typename T>
+  void handOff(int per) {
+      AtomicMaybe<T> slot;
+      std::atomic<long> received{0};
+      std::atomic<long> sum{0};
+      std::atomic<bool> produced{false};
+
+      std::vector<std::thread> producers;
+      for (int p = 0; p < 2; ++p) {
+          producers.emplace_back([&] {
+              for (int i = 1; i <= per; ++i) {
+                  Maybe<T> empty;
+                  while (!slot.compare_exchange(empty, Maybe<T>(make<T>(i)))) {
+                      empty = Maybe<T>();
+                      std::this_thread::yield();
+                  }
+              }
+          });
+      }
+      std::vector<std::thread> consumers;
+      for (int c = 0; c < 2; ++c) {
+          consumers.emplace_back([&] {
+              while (!produced || slot.load()) {
+                  Maybe<T> m = slot.take();
+                  if (m) {
+                      ++received;
+                      sum += make<T>(1) == *m ? 1 : 0;
+                  } else {
+                      std::this_thread::yield();
+                  }
+              }
+          });
+      }
+      for (std::thread& t : producers) {
+          t.join();
+      }
+      produced = true;
+      for (std::thread& t : consumers) {
+          t.join();
+      }
+      check(received == 2 * per, "every value handed off arrives");
+      check(sum == 2, "and arrives once");
+  }
+
+  template <typename T>
+  void layout(T a, T b) {
+      single<T>(a, b);
+      handOff<T>(2000);
+  }
+}
+
+int main() {
+    int x = 1;
+    int y = 2;
+    layout<int>(1, 2);
+    layout<int*>(&x, &y);
+    layout<long long>(1LL << 40, -1);
+    layout<double>(1.5, -0.25);
+    single<std::string>("a", "b");
+    handOff<std::string>(2000);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+/*
+ * Checks the hazard pointer domain: retired objects are freed once
+ * nothing protects them and never while something does, objects still
+ * protected when their retiring thread exits are freed by a later one,
+ * and readers racing a writer never see a freed object.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "MaybeHazard.h"
+
+namespace
+{
+  int failures = 0;
+
+  void check(bool ok, const char* what) {
+      if (!ok) {
+          std::fprintf(stderr, "FAILED: %s\n", what);
+          ++failures;
+      }
+  }
+
+  std::atomic<int> live{0};
+
+  struct Tracked {
+      int value;
+      std::atomic<bool> alive;
+
+      explicit Tracked(int value) : value(value), alive(true) {
+          ++live;
+      }
+
+      ~Tracked() {
+          alive = false;
+          --live;
+      }
+  };
+
+  //retires another Tracked from its destructor
+  struct Chained {
+      Tracked* next;
+
+      ~Chained() {
+          Maybe_Detail::HazardDomain::instance().retire(next);
+      }
+  };
+
+  Maybe_Detail::HazardDomain& domain() {
+      return Maybe_Detail::HazardDomain::instance();
+  }
+
+  void unprotected() {
+      std::thread t([] {
+          for (int i = 0; i < 1000; ++i) {
+              domain().retire(new Tracked(i));
+          }
+          check(live < 1000, "retiring frees unprotected objects as it goes");
+          domain().retire(new Chained{new Tracked(-1)});
+      });
+      t.join();
+      check(live == 0, "everything is freed by the time the thread exits, even objects a deleter retires");
+  }
+
+  void protectedMeanwhile() {
+      std::atomic<Tracked*> src{new Tracked(1)};
+      Tracked* kept;
+      {
+          Maybe_Detail::HazardGuard guard;
+          kept = guard.protect(src);
+
+          std::thread writer([&] {
+              Tracked* old = src.exchange(nullptr);
+              domain().retire(old);
+              //enough retiring to force a scan
+              for (int i = 0; i < 1000; ++i) {
+                  domain().retire(new Tracked(i));
+              }
+          });
+          writer.join();
+          check(live == 1 && kept->alive && kept->value == 1,
+                "a protected object survives its retiring thread exiting");
+      }
+
+      //freed by whichever thread next cleans up
+      std::thread later([] {
+          domain().retire(new Tracked(2));
+      });
+      later.join();
+      check(live == 0, "once unprotected, an orphaned object is freed by a later thread");
+  }
+
+  void readersAndWriter() {
+      std::atomic<Tracked*> src{new Tracked(0)};
+      std::atomic<bool> stop{false};
+      std::atomic<int> stale{0};
+      std::atomic<int> started{0};
+
+      std::vector<std::thread> readers;
+      for (int r = 0; r < 3; ++r) {
+          readers.emplace_back([&] {
+              Maybe_Detail::HazardGuard guard;
+              int last = 0;
+              ++started;
+              while (!stop) {
+                  Tracked* p = guard.protect(src);
+                  if (!p->alive || p->value < last) {
+                      ++stale;
+                  }
+                  last = p->value;
+                  guard.reset();
+                  std::this_thread::yield();
+              }
+          });
+      }
+
+      std::thread writer([&] {
+          while (started < 3) {
+              std::this_thread::yield();
+          }
+          for (int i = 1; i <= 20000; ++i) {
+              domain().retire(src.exchange(new Tracked(i)));
+              if (i % 64 == 0) {
+                  std::this_thread::yield();
+              }
+          }
+          stop = true;
+      });
+      writer.join();
+      for (std::thread& t : readers) {
+          t.join();
+      }
+
+      check(stale == 0, "readers only ever see live objects, in order");
+      std::thread cleanup([&] {
+          domain().retire(src.exchange(nullptr));
+      });
+      cleanup.join();
+      check(live == 0, "every replaced object is freed");
+  }
+}
+
+int main() {
+    unprotected();
+    protectedMeanwhile();
+    readersAndWriter();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,50 @@
+/*
+ * Checks that a LazyMaybe built from a Maybe holds that Maybe's
+ * contents, rather than treating the Maybe as a factory (a Maybe is
+ * invocable through its checked operator()()).
+ */
+
+#include <cstdio>
+
+#include "LazyMaybe.h"
+
+namespace
+{
+  int failures = 0;
+
+  void check(bool ok, const char* what) {
+      if (!ok) {
+          std::fprintf(stderr, "FAILED: %s\n", what);
+          ++failures;
+      }
+  }
+
+  template <typename Policy>
+  void fromMaybe() {
+      Maybe<int> empty;
+      LazyMaybe<int, Policy> fromEmptyLvalue(empty);
+      check(!fromEmptyLvalue, "built from an empty lvalue Maybe, it is empty");
+
+      Maybe<int> five(5);
+      LazyMaybe<int, Policy> fromLvalue(five);
+      check(fromLvalue && fromLvalue() == 5, "built from an lvalue Maybe, it holds its value");
+
+      const Maybe<int> constFive(5);
+      LazyMaybe<int, Policy> fromConst(constFive);
+      check(fromConst && fromConst() == 5, "built from a const Maybe, it holds its value");
+
+      LazyMaybe<int, Policy> fromRvalue(Maybe<int>(7));
+      check(fromRvalue && fromRvalue() == 7, "built from an rvalue Maybe, it holds its value");
+
+      int calls = 0;
+      LazyMaybe<int, Policy> lazy([&calls] { ++calls; return Maybe<int>(9); });
+      check(calls == 0, "a factory does not run until first use");
+      check(lazy && lazy() == 9 && calls == 1, "a factory runs once, on first use");
+  }
+}
+
+int main() {
+    fromMaybe<MaybeSingleThreaded>();
+    fromMaybe<MaybeThreadSafe>();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+/*
+ * Checks batch construction and destruction of Maybes: every kind of
+ * source element, rollback when a constructor throws, single pass
+ * destruction, and MaybeArray building arena boxed elements with all
+ * of their values in one block.
+ */
+
+#include <cstddef>
+#include <cstdio>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "MaybeBatch.h"
+#include "MaybeVector.h"
+
+namespace
+{
+  int failures = 0;
+
+  void check(bool ok, const char* what) {
+      if (!ok) {
+          std::fprintf(stderr, "FAILED: %s\n", what);
+          ++failures;
+      }
+  }
+
+  int live = 0;
+
+  //counts live instances, and throws when built from a negative number
+  struct Counted {
+      int value;
+
+      Counted(int value) : value(value) {
+          if (value < 0) {
+              throw std::runtime_error("negative");
+          }
+          ++live;
+      }
+
+      Counted(const Counted& other) : value(other.value) {
+          ++live;
+      }
+
+      ~Counted() {
+          --live;
+      }
+  };
+
+  template <typename M>
+  struct Raw {
+      alignas(M) unsigned char bytes[8 * sizeof(M)];
+
+      M* get() {
+          return reinterpret_cast<M*>(bytes);
+      }
+  };
+
+  void sources() {
+      typedef Maybe<std::string> M;
+      MaybeVector<std::string> column;
+      column.push_back(std::string("proxy"));
+      column.push_back(nullptr);
+
+      Raw<M> raw;
+      M* out = raw.get();
+      std::vector<M> maybes = {M("maybe"), M()};
+      maybe_uninitialized_construct_n(maybes.begin(), 2, out);
+      maybe_uninitialized_construct_n(column.begin(), 2, out + 2);
+      const char* values[] = {"value", "other"};
+      const char** next = maybe_uninitialized_construct_n(values, 1, out + 4);
+      std::nullptr_t nulls[] = {nullptr};
+      maybe_uninitialized_construct_n(nulls, 1, out + 5);
+
+      check(next == values + 1, "the returned iterator is past the last element used");
+      check(*out[0] == "maybe" && !out[1], "Maybe sources are copied, empty or not");
+      check(*out[2] == "proxy" && !out[3], "and so are MaybeVector elements");
+      check(*out[4] == "value", "bare values are built from");
+      check(!out[5], "nullptr gives an empty Maybe");
+      maybe_destroy_n(out, 6);
+  }
+
+  void rollback() {
+      typedef Maybe<Counted> M;
+      Raw<M> raw;
+      int values[] = {1, 2, -3, 4};
+      bool threw = false;
+      try {
+          maybe_uninitialized_construct_n(values, 4, raw.get());
+      } catch (const std::runtime_error&) {
+          threw = true;
+      }
+      check(threw && live == 0, "when one element throws, those already built are destroyed");
+
+      maybe_uninitialized_construct_n(values, 2, raw.get());
+      check(live == 2, "built elements are live");
+      maybe_destroy_n(raw.get(), 2);
+      check(live == 0, "maybe_destroy_n runs their destructors");
+  }
+
+  void arrays() {
+      std::vector<Maybe<int> > input;
+      for (int i = 0; i < 1000; ++i) {
+          input.push_back(i % 4 == 0 ? Maybe<int>() : Maybe<int>(i));
+      }
+
+      MaybeArray<int> inlined = make_maybe_array<int>(input);
+      check(inlined.size() == 1000 && !inlined[0] && *inlined[999] == 999, "an inline array holds its input");
+
+      MaybeArray<int, MaybeArenaBoxed> boxed = make_maybe_array<int, MaybeArenaBoxed>(input);
+
+      bool same = boxed.size() == input.size();
+      const char* lowest = nullptr;
+      const char* highest = nullptr;
+      for (std::size_t i = 0; same && i < boxed.size(); ++i) {
+          same = boxed[i] == input[i];
+          if (boxed[i]) {
+              const char* p = reinterpret_cast<const char*>(&*boxed[i]);
+              lowest = lowest == nullptr || p < lowest ? p : lowest;
+              highest = highest == nullptr || p > highest ? p : highest;
+          }
+      }
+      check(same, "an arena boxed array holds its input");
+      check(std::size_t(highest - lowest) < 1000 * sizeof(int) + alignof(std::max_align_t),
+            "and its values sit in one block");
+
+      boxed[0] = 5;
+      check(boxed[0] && *boxed[0] == 5, "an emptied element can be given a value");
+
+      MaybeArray<int, MaybeArenaBoxed> moved(std::move(boxed));
+      check(moved.size() == 1000 && boxed.empty() && *moved[0] == 5, "moving an array moves its elements");
+      moved = make_maybe_array<int, MaybeArenaBoxed>(std::vector<int>{7});
+      check(moved.size() == 1 && *moved[0] == 7, "move assigning replaces them");
+
+      std::istringstream text("1 2 3");
+      MaybeArray<int> parsed(std::istream_iterator<int>(text), 3);
+      check(parsed.size() == 3 && *parsed[2] == 3, "an array can be built from single pass input");
+
+      {
+          MaybeArray<Counted, MaybeArenaBoxed> counted = make_maybe_array<Counted, MaybeArenaBoxed>(std::vector<int>{1, 2, 3});
+          check(live == 3, "an array of non-trivial values builds each one");
+      }
+      check(live == 0, "and destroys each one");
+
+      bool threw = false;
+      try {
+          MaybeArray<Counted> bad = make_maybe_array<Counted>(std::vector<int>{1, -1});
+      } catch (const std::runtime_error&) {
+          threw = true;
+      }
+      check(threw && live == 0, "an array whose element throws leaks nothing");
+  }
+}
+
+int main() {
+    sources();
+    rollback();
+    arrays();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+/*
+ * Checks MaybeCache lookups, cached misses, erasing, growth, and that
+ * a Handle keeps its entry readable after it is replaced, then runs
+ * lock-free readers against writers on the same keys.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MaybeCache.h"
+
+namespace
+{
+  int failures = 0;
+
+  void check(bool ok, const char* what) {
+      if (!ok) {
+          std::fprintf(stderr, "FAILED: %s\n", what);
+          ++failures;
+      }
+  }
+
+  void lookups() {
+      MaybeCache<int, std::string> cache(4);
+      check(!cache.find(1).cached() && cache.size() == 0, "a new cache has nothing");
+
+      cache.insert_or_assign(1, Maybe<std::string>("one"));
+      cache.insert_or_assign(2, Maybe<std::string>());
+      MaybeCache<int, std::string>::Handle one = cache.find(1);
+      MaybeCache<int, std::string>::Handle two = cache.find(2);
+      check(one.cached() && !one.absent() && one.value() && *one.value() == "one", "a stored value is found");
+      check(two.cached() && two.absent() && !two.value(), "a stored absence is found as one");
+      check(cache.size() == 2, "both count");
+
+      cache.insert_or_assign(1, Maybe<std::string>("uno"));
+      check(*one.value() == "one", "a handle keeps the entry it found after it is replaced");
+      check(*cache.find(1).value() == "uno", "while new lookups see the replacement");
+      check(cache.size() == 2, "replacing does not add a key");
+
+      MaybeCache<int, std::string>::Handle moved = std::move(one);
+      check(moved.value() && *moved.value() == "one" && !one.cached(), "moving a handle moves its entry");
+
+      cache.erase(1);
+      check(!cache.find(1).cached() && cache.size() == 1, "erase forgets a value");
+      cache.erase(2);
+      check(!cache.find(2).cached() && cache.size() == 0, "and an absence");
+      cache.erase(3);
+      check(cache.size() == 0, "erasing a missing key does nothing");
+      check(*moved.value() == "one", "a handle outlives its entry being erased");
+  }
+
+  void loading() {
+      MaybeCache<int, int> cache;
+      int calls = 0;
+      auto loader = [&calls](int k) {
+          ++calls;
+          return k % 2 == 0 ? Maybe<int>(k * 10) : Maybe<int>();
+      };
+
+      check(*cache.get_or_load(4, loader).value() == 40 && calls == 1, "a miss runs the loader");
+      check(*cache.get_or_load(4, loader).value() == 40 && calls == 1, "a hit does not");
+      check(cache.get_or_load(5, loader).absent() && calls == 2, "an empty result is cached");
+      check(cache.get_or_load(5, loader).absent() && calls == 2, "so the loader is not asked again");
+  }
+
+  void growth() {
+      //one shard, so every key lands in the same table
+      MaybeCache<int, int> cache(1);
+      cache.insert_or_assign(0, Maybe<int>());
+      MaybeCache<int, int>::Handle early = cache.find(0);
+      for (int k = 1; k < 5000; ++k) {
+          cache.insert_or_assign(k, k % 3 == 0 ? Maybe<int>() : Maybe<int>(k));
+      }
+      bool all = cache.size() == 5000;
+      for (int k = 0; all && k < 5000; ++k) {
+          MaybeCache<int, int>::Handle h = cache.find(k);
+          all = h.cached() && (k % 3 == 0 ? h.absent() : *h.value() == k);
+      }
+      check(all, "every key survives the table growing");
+      check(early.cached() && early.absent(), "a handle taken before growth still reads");
+
+      cache.clear();
+      check(cache.size() == 0 && !cache.find(7).cached(), "clear forgets everything");
+      check(early.absent(), "even across a clear");
+  }
+
+  //writers store k * 1000 + version for key k, and readers check that
+  //whatever they find belongs to the key they asked for
+  void concurrent() {
+      MaybeCache<int, int> cache(4);
+      const int keys = 256;
+      std::atomic<bool> stop{false};
+      std::atomic<int> wrong{0};
+
+      std::vector<std::thread> readers;
+      for (int r = 0; r < 3; ++r) {
+          readers.emplace_back([&, r] {
+              int k = r;
+              while (!stop) {
+                  k = (k + 7) % keys;
+                  MaybeCache<int, int>::Handle h = cache.find(k);
+                  if (Maybe<const int&> v = h.value()) {
+                      if (v() / 1000 != k) {
+                          ++wrong;
+                      }
+                  }
+                  std::this_thread::yield();
+              }
+          });
+      }
+
+      std::vector<std::thread> writers;
+      for (int w = 0; w < 2; ++w) {
+          writers.emplace_back([&, w] {
+              for (int version = 0; version <= 20; ++version) {
+                  for (int k = w; k < keys; k += 2) {
+                      if (version % 5 == 4) {
+                          cache.erase(k);
+                      } else {
+                          cache.insert_or_assign(k, Maybe<int>(k * 1000 + version));
+                      }
+                  }
+                  std::this_thread::yield();
+              }
+          });
+      }
+      for (std::thread& t : writers) {
+          t.join();
+      }
+      stop = true;
+      for (std::thread& t : readers) {
+          t.join();
+      }
+
+      check(wrong == 0, "readers only find their own key's values");
+      bool latest = true;
+      for (int k = 0; k < keys; ++k) {
+          MaybeCache<int, int>::Handle h = cache.find(k);
+          latest = latest && h.value() && *h.value() == k * 1000 + 20;
+      }
+      check(latest && cache.size() == std::size_t(keys), "the last write to each key wins");
+  }
+}
+
+int main() {
+    lookups();
+    loading();
+    growth();
+    concurrent();
+    return failures == 0 ? 0 : 1;
+}
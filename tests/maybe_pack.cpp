@@ -0,0 +1,126 @@
+/*
+ * Checks MaybePack and maybe_get: fields of mixed sizes keep their own
+ * values, each field's bit tracks it, emptied fields compare like
+ * never set ones, and the field proxies act like a Maybe<T>&.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+
+#include "MaybePack.h"
+
+namespace
+{
+  int failures = 0;
+
+  void check(bool ok, const char* what) {
+      if (!ok) {
+          std::fprintf(stderr, "FAILED: %s\n", what);
+          ++failures;
+      }
+  }
+
+  typedef MaybePack<char, double, std::int16_t, std::int32_t, bool> Mixed;
+
+  void fields() {
+      Mixed pack;
+      check(pack.none() && !pack.any() && !pack.all() && pack.mask() == 0, "a new pack has no fields set");
+
+      pack.get<0>() = 'a';
+      pack.get<1>() = 2.5;
+      pack.get<2>() = std::int16_t(-3);
+      pack.get<3>() = 40000;
+      pack.get<4>() = false;
+      check(pack.all() && pack.mask() == 0x1f, "setting every field sets every bit");
+      check(*pack.get<0>() == 'a' && *pack.get<1>() == 2.5 && *pack.get<2>() == -3 && *pack.get<3>() == 40000 &&
+            pack.get<4>() && !*pack.get<4>(),
+            "fields of different sizes keep their own values");
+
+      pack.get<1>() = nullptr;
+      check(!pack.get<1>() && pack.mask() == 0x1d && pack.any() && !pack.all(), "emptying a field clears its bit only");
+      check(pack.get<1>().value_or(9.0) == 9.0 && pack.get<1>().get_if() == nullptr, "an empty field falls back");
+
+      bool threw = false;
+      try {
+          pack.get<1>()();
+      } catch (const null_maybe_exception&) {
+          threw = true;
+      }
+      check(threw, "checked extraction from an empty field throws");
+
+      pack.get<1>() = Maybe<double>(1.0);
+      check(pack.get<1>() && *pack.get<1>() == 1.0, "a field can be assigned a Maybe");
+      pack.get<1>() = Maybe<double>();
+      check(!pack.get<1>(), "including an empty one");
+
+      pack.reset();
+      check(pack.none(), "reset empties every field");
+      check(pack == Mixed(), "and leaves the pack equal to a new one");
+  }
+
+  void construction() {
+      Mixed source('z', 1.0, nullptr, Maybe<std::int32_t>(7), Maybe<bool>());
+      check(source.mask() == 0x0b, "construction takes values, nullptr and Maybes");
+
+      Mixed copy(source.get<0>(), nullptr, std::int16_t(5), source.get<3>(), true);
+      check(*copy.get<0>() == 'z' && !copy.get<1>() && *copy.get<3>() == 7 && *copy.get<4>(),
+            "and field proxies of another pack");
+
+      Mixed same = source;
+      check(same == source && same != copy, "packs compare field by field");
+
+      //set then emptied, against never set
+      Mixed cleared = source;
+      cleared.get<1>() = 3.0;
+      cleared.get<1>() = nullptr;
+      Mixed never('z', nullptr, nullptr, 7, nullptr);
+      check(cleared.mask() == never.mask() && cleared != source, "emptying a field drops its value");
+      source.get<1>() = nullptr;
+      check(cleared == source, "and equal set fields compare equal whatever was there before");
+  }
+
+  void proxies() {
+      MaybePack<int, int, long> pack(1, nullptr, 3L);
+
+      pack.get<1>() = pack.get<0>();
+      check(pack.get<1>() && *pack.get<1>() == 1, "a field can be assigned from another");
+      pack.get<1>() = MaybePack<int, int, long>().get<0>();
+      check(!pack.get<1>(), "including an empty one");
+
+      Maybe<int> out = maybe_get<0>(pack);
+      check(out && *out == 1, "maybe_get copies out like get");
+      maybe_get<2>(pack) = 30L;
+      check(*pack.get<2>() == 30, "and assigns through like get");
+
+      const MaybePack<int, int, long>& view = pack;
+      MaybePack<int, int, long>::Ref<0, true> constField = pack.get<0>();
+      check(maybe_get<0>(view) == constField && *constField == 1, "a mutable field converts to a const one");
+      check(maybe_get<0>(view) == Maybe<int>(1) && maybe_get<1>(view) == Maybe<int>(), "fields compare with Maybes");
+      check(maybe_get<0>(view) != maybe_get<1>(view), "and with other fields");
+
+      *pack.get<2>() += 1;
+      check(*view.get<2>() == 31 && pack.get<2>().get_if() == &*view.get<2>(), "* and get_if reach the stored value");
+  }
+
+  template <std::size_t... Is>
+  MaybePack<decltype(Is, std::uint8_t())...> wide(std::index_sequence<Is...>) {
+      return MaybePack<decltype(Is, std::uint8_t())...>(std::uint8_t(Is)...);
+  }
+
+  void sixtyFour() {
+      auto pack = wide(std::make_index_sequence<64>());
+      check(pack.all() && pack.mask() == ~std::uint64_t(0), "64 fields fill the whole word");
+      check(*pack.get<63>() == 63 && *pack.get<0>() == 0 && *pack.get<31>() == 31, "and each keeps its value");
+      pack.get<63>() = nullptr;
+      check(!pack.all() && pack.mask() == ~std::uint64_t(0) >> 1, "the top field is the top bit");
+  }
+}
+
+int main() {
+    fields();
+    construction();
+    proxies();
+    sixtyFour();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+/*
+ * Checks MaybeVector's element access and bitmap upkeep: values and
+ * empties read back, the bits past size() stay zero across growing and
+ * shrinking, and element references assign like a Maybe<T>&.
+ */
+
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+#include "MaybeVector.h"
+
+namespace
+{
+  int failures = 0;
+
+  void check(bool ok, const char* what) {
+      if (!ok) {
+          std::fprintf(stderr, "FAILED: %s\n", what);
+          ++failures;
+      }
+  }
+
+  //every bit at or past size() is zero
+  template <typename T>
+  bool tailClear(const MaybeVector<T>& v) {
+      for (std::size_t i = v.size(); i < v.bitmapWords() * 64; ++i) {
+          if ((v.bitmap()[i / 64] >> (i % 64)) & 1) {
+              return false;
+          }
+      }
+      return v.bitmapWords() == (v.size() + 63) / 64;
+  }
+
+  void elements() {
+      MaybeVector<int> v = {Maybe<int>(1), Maybe<int>(), Maybe<int>(3)};
+      check(v.size() == 3 && v[0] && !v[1] && v[2], "an initializer list keeps which elements are engaged");
+      check(*v[0] == 1 && *v[2] == 3, "and their values");
+      check(v[1].value_or(9) == 9, "value_or falls back for an empty element");
+
+      v.push_back(nullptr);
+      v.push_back(Maybe<int>(5));
+      check(v.size() == 5 && !v[3] && v[4] && *v[4] == 5, "push_back appends values and empties");
+
+      bool threw = false;
+      try {
+          v.at(5);
+      } catch (const std::out_of_range&) {
+          threw = true;
+      }
+      check(threw, "at() throws past the end");
+
+      int engaged = 0;
+      for (MaybeVector<int>::const_reference r : v) {
+          engaged += r ? 1 : 0;
+      }
+      check(engaged == 3, "iteration visits every element");
+      check(v.end() - v.begin() == 5, "iterators span the vector");
+  }
+
+  void bitmap() {
+      MaybeVector<int> v;
+      for (int i = 0; i < 130; ++i) {
+          v.push_back(i);
+      }
+      check(v.bitmapWords() == 3 && tailClear(v), "pushing across word boundaries keeps the tail clear");
+
+      v.resize(65);
+      check(v.bitmapWords() == 2 && tailClear(v), "shrinking clears the bits it drops");
+      check(v[64] && *v[64] == 64, "and keeps the ones it doesn't");
+
+      v.resize(200);
+      check(tailClear(v) && !v[65] && !v[199], "growing again adds empty elements");
+
+      v.pop_back();
+      check(v.size() == 199 && tailClear(v), "pop_back drops the last bit");
+
+      MaybeVector<int> sized(70);
+      check(sized.size() == 70 && !sized[0] && !sized[69] && tailClear(sized), "a sized vector starts empty");
+
+      v.clear();
+      check(v.empty() && v.bitmapWords() == 0, "clear drops everything");
+  }
+
+  void references() {
+      MaybeVector<std::string> v(3);
+      v[0] = "zero";
+      v[1] = Maybe<std::string>("one");
+      v[2] = v[0];
+      check(v[0] && *v[0] == "zero" && *v[1] == "one" && *v[2] == "zero",
+            "assigning a value, a Maybe or another element engages the element");
+
+      v[0] = nullptr;
+      check(!v[0] && v.data()[0].empty(), "emptying an element drops what its string held");
+      v[1] = Maybe<std::string>();
+      check(!v[1], "assigning an empty Maybe empties the element");
+      v[2] = v[1];
+      check(!v[2], "and so does assigning an empty element");
+
+      Maybe<std::string> copy = v[0];
+      check(!copy, "copying out an empty element gives an empty Maybe");
+      v.emplace_back(4, 'x');
+      copy = v[3];
+      check(copy && *copy == "xxxx", "copying out an engaged element gives its value");
+      check(v[3]->size() == 4 && v[3].get_if() == &v.data()[3], "-> and get_if reach the stored value");
+
+      const MaybeVector<std::string>& cv = v;
+      check(cv[3] == v[3] && cv[0] != v[3], "const and mutable references compare");
+  }
+
+  void bools() {
+      MaybeVector<bool> v;
+      v.push_back(true);
+      v.push_back(nullptr);
+      v.push_back(false);
+      bool* values = v.data();
+      check(values[0] && !values[2], "a bool vector keeps real bools");
+      check(&*v[0] == values, "and hands out references into them");
+      check(v[2] && !*v[2] && !v[1], "a false value is still engaged");
+  }
+}
+
+int main() {
+    elements();
+    bitmap();
+    references();
+    bools();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,186 @@
+/*
+ * Checks MaybeThreadPool and the parallel algorithms against their
+ * sequential results: every chunk runs once, exceptions reach the
+ * caller, nested and concurrent loops work, and transforms into a
+ * MaybeVector which starts part way through a bitmap word don't race
+ * on the words neighbouring chunks share.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MaybeParallel.h"
+
+namespace
+{
+  int failures = 0;
+
+  void check(bool ok, const char* what) {
+      if (!ok) {
+          std::fprintf(stderr, "FAILED: %s\n", what);
+          ++failures;
+      }
+  }
+
+  void pool() {
+      MaybeThreadPool pool(4);
+      check(pool.size() == 4, "the caller counts as one of the threads");
+
+      std::vector<std::atomic<int> > runs(1000);
+      pool.run(runs.size(), [&](std::size_t i) { ++runs[i]; });
+      bool once = true;
+      for (std::atomic<int>& r : runs) {
+          once = once && r == 1;
+      }
+      check(once, "every chunk runs exactly once");
+
+      std::atomic<int> inner{0};
+      pool.run(8, [&](std::size_t) {
+          pool.run(4, [&](std::size_t) { ++inner; });
+      });
+      check(inner == 32, "a loop started from a chunk runs inline");
+
+      bool threw = false;
+      try {
+          pool.run(100, [](std::size_t i) {
+              if (i == 42) {
+                  throw std::runtime_error("chunk 42");
+              }
+          });
+      } catch (const std::runtime_error&) {
+          threw = true;
+      }
+      check(threw, "an exception from a chunk reaches the caller");
+
+      std::atomic<int> after{0};
+      pool.run(10, [&](std::size_t) { ++after; });
+      check(after == 10, "and the pool still works afterwards");
+
+      std::atomic<long> total{0};
+      std::vector<std::thread> submitters;
+      for (int t = 0; t < 3; ++t) {
+          submitters.emplace_back([&] {
+              for (int round = 0; round < 20; ++round) {
+                  pool.run(16, [&](std::size_t i) { total += long(i); });
+              }
+          });
+      }
+      for (std::thread& t : submitters) {
+          t.join();
+      }
+      check(total == 3 * 20 * 120, "loops started from several threads at once take turns");
+
+      MaybeThreadPool single(1);
+      std::atomic<int> alone{0};
+      single.run(5, [&](std::size_t) { ++alone; });
+      check(single.size() == 1 && alone == 5, "a pool of one runs everything on the caller");
+  }
+
+  //long empty stretches, to check the cuts balance by values held
+  Maybe<int> element(std::size_t i) {
+      bool held = (i / 10000) % 3 == 0 ? i % 2 == 0 : i % 97 == 0;
+      return held ? Maybe<int>(int(i % 1000)) : Maybe<int>();
+  }
+
+  void reductions() {
+      MaybeThreadPool pool(4);
+      const std::size_t n = 100000;
+      std::vector<Maybe<int> > maybes;
+      MaybeVector<int> column;
+      long expected = 0;
+      long squares = 0;
+      for (std::size_t i = 0; i < n; ++i) {
+          maybes.push_back(element(i));
+          column.push_back(element(i));
+          if (maybes.back()) {
+              expected += *maybes.back();
+              squares += long(*maybes.back()) * *maybes.back();
+          }
+      }
+
+      auto square = [](int v) { return long(v) * v; };
+      check(maybe_reduce(pool, maybes, 0L, std::plus<long>()) == expected, "reducing Maybes on a pool");
+      check(maybe_reduce(pool, column, 0L, std::plus<long>()) == expected, "reducing a MaybeVector on a pool");
+      check(maybe_reduce(column, 0L, std::plus<long>()) == expected, "reducing without one");
+      check(maybe_transform_reduce(pool, maybes, 0L, std::plus<long>(), square) == squares,
+            "transform reducing Maybes on a pool");
+      check(maybe_transform_reduce(pool, column, 0L, std::plus<long>(), square) == squares,
+            "transform reducing a MaybeVector on a pool");
+
+      MaybeVector<int> none(n);
+      check(maybe_reduce(pool, none, 7L, std::plus<long>()) == 7, "an all empty vector reduces to init");
+      MaybeVector<int> nothing;
+      check(maybe_reduce(pool, nothing, 7L, std::plus<long>()) == 7, "and so does an empty one");
+  }
+
+  void transforms() {
+      MaybeThreadPool pool(4);
+      const std::size_t n = 50000;
+      std::vector<Maybe<int> > maybes;
+      MaybeVector<int> column;
+      for (std::size_t i = 0; i < n; ++i) {
+          maybes.push_back(element(i));
+          column.push_back(element(i));
+      }
+      auto twice = [](int v) { return std::to_string(2 * v); };
+
+      std::vector<Maybe<std::string> > strings(n);
+      maybe_transform(pool, maybes.begin(), maybes.end(), strings.begin(), twice);
+      bool same = true;
+      for (std::size_t i = 0; same && i < n; ++i) {
+          same = maybes[i] ? strings[i] && *strings[i] == twice(*maybes[i]) : !strings[i];
+      }
+      check(same, "transforming into Maybes keeps empties empty and maps values");
+
+      //starting 37 elements in, so chunks are cut on the output's words
+      for (std::size_t lead : {std::size_t(0), std::size_t(37), std::size_t(63)}) {
+          MaybeVector<long> out(n + lead);
+          for (std::size_t i = 0; i < n + lead; ++i) {
+              out[i] = -1L;
+          }
+          auto end = maybe_transform(pool, maybes.begin(), maybes.end(), out.begin() + lead, [](int v) { return long(v) + 1; });
+          bool ok = end == out.end() && out[0] && (lead == 0 || *out[lead - 1] == -1);
+          for (std::size_t i = 0; ok && i < n; ++i) {
+              ok = maybes[i] ? out[lead + i] && *out[lead + i] == *maybes[i] + 1 : !out[lead + i];
+          }
+          check(ok, "transforming into a MaybeVector part way through a word");
+      }
+
+      MaybeVector<std::string> mapped = maybe_transform(pool, column, twice);
+      bool mappedOk = mapped.size() == n;
+      for (std::size_t i = 0; mappedOk && i < n; ++i) {
+          mappedOk = column[i] ? mapped[i] && *mapped[i] == twice(*column[i]) : !mapped[i];
+      }
+      check(mappedOk, "transforming a MaybeVector keeps its empties");
+      check(maybe_transform(column, twice)[0] == mapped[0], "and gives the same without a pool");
+  }
+
+  void views() {
+      MaybeVector<int> column = {Maybe<int>(), Maybe<int>(1), Maybe<int>(), Maybe<int>(2), Maybe<int>()};
+      int seen = 0;
+      int sum = 0;
+      for (auto r : maybe_engaged(column)) {
+          seen += r ? 1 : 0;
+      }
+      for (int v : maybe_values(column)) {
+          sum += v;
+      }
+      check(seen == 2 && sum == 3, "the views skip the empty elements");
+
+      std::vector<Maybe<int> > empties(3);
+      check(maybe_values(empties).begin() == maybe_values(empties).end(), "a view over empties is empty");
+  }
+}
+
+int main() {
+    pool();
+    reductions();
+    transforms();
+    views();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+/*
+ * Checks that Maybe proxies compare with bare values and nullptr the
+ * way a Maybe does, rather than through their conversion to bool.
+ */
+
+#include <cstdio>
+#include <string>
+
+#include "LazyMaybe.h"
+#include "MaybePack.h"
+#include "MaybeVector.h"
+
+namespace
+{
+  int failures = 0;
+
+  void check(bool ok, const char* what) {
+      if (!ok) {
+          std::fprintf(stderr, "FAILED: %s\n", what);
+          ++failures;
+      }
+  }
+
+  /*!
+   * Runs the comparisons on a proxy p holding 5 and one, empty,
+   * holding nothing
+   */
+  template <typename Full, typename Empty>
+  void compare(const char* kind, const Full& p, const Empty& empty) {
+      std::string what(kind);
+
+      check(p == 5 && 5 == p, (what + " == its value").c_str());
+      check(!(p == 1) && !(1 == p), (what + " != 1, though its bool is 1").c_str());
+      check(p != 6 && 6 != p && !(p != 5), (what + " != another value").c_str());
+      check(!(empty == 0) && empty != 0 && !(empty == 1), (what + " that is empty equals no value").c_str());
+
+      check(empty == nullptr && nullptr == empty && p != nullptr && !(p == nullptr), (what + " against nullptr").c_str());
+
+      check(p < 6 && !(p < 5) && 4 < p && !(5 < p), (what + " < a value").c_str());
+      check(p > 4 && 6 > p && p <= 5 && 5 <= p && p >= 5 && 5 >= p, (what + " ordered against a value").c_str());
+      check(empty < 0 && !(0 < empty) && 0 > empty && empty <= 0, (what + " that is empty orders first").c_str());
+  }
+}
+
+int main() {
+    MaybeVector<int> v(2);
+    v[0] = 5;
+    compare("MaybeVector element", v[0], v[1]);
+    const MaybeVector<int>& cv = v;
+    compare("const MaybeVector element", cv[0], cv[1]);
+
+    MaybePack<int, float, int> pack;
+    pack.get<0>() = 5;
+    compare("MaybePack field", pack.get<0>(), pack.get<2>());
+    compare("maybe_get field", maybe_get<0>(pack), maybe_get<2>(pack));
+
+    LazyMaybe<int> lazy([] { return Maybe<int>(5); });
+    LazyMaybe<int> lazyEmpty([] { return Maybe<int>(); });
+    compare("LazyMaybe", lazy, lazyEmpty);
+
+    compare("Maybe", Maybe<int>(5), Maybe<int>());
+
+    MaybeVector<std::string> names(1);
+    names[0] = std::string("root");
+    check(names[0] == "root" && names[0] != "rot", "a MaybeVector<std::string> element against a string literal");
+
+    MaybeVector<bool> flags(2);
+    flags[0] = false;
+    check(flags[0] == false && !(flags[0] == true) && !(flags[1] == false), "a MaybeVector<bool> element against a bool");
+
+    return failures == 0 ? 0 : 1;
+}
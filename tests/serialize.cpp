@@ -0,0 +1,160 @@
+/*
+ * Checks that MaybeWriter only writes raw bytes for types with no
+ * padding, so equal values always give equal output, and that a sink's
+ * failure is reported through good().
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "MaybeSerialize.h"
+
+namespace
+{
+  int failures = 0;
+
+  void check(bool ok, const char* what) {
+      if (!ok) {
+          std::fprintf(stderr, "FAILED: %s\n", what);
+          ++failures;
+      }
+  }
+
+  struct Padded {
+      char tag;
+      int count;
+  };
+
+  struct Dense {
+      int a;
+      int b;
+  };
+
+  struct Zeroed {
+      char tag;
+      int count;
+  };
+}
+
+template <>
+struct maybe_serializer<Padded> {
+    template <typename W>
+    static void write(W& out, const Padded& p) {
+        out.value(p.tag);
+        out.value(p.count);
+    }
+
+    static Padded read(MaybeReader& in) {
+        Padded p;
+        p.tag = in.value<char>();
+        p.count = in.value<int>();
+        return p;
+    }
+};
+
+template <>
+struct maybe_zero_padded<Zeroed> : std::true_type {};
+
+static_assert(Maybe_Detail::IsRawSerialized<int>::value && Maybe_Detail::IsRawSerialized<double>::value,
+              "scalars are written raw");
+static_assert(Maybe_Detail::IsRawSerialized<Dense>::value, "a struct without padding is written raw");
+static_assert(!Maybe_Detail::IsRawSerialized<Padded>::value, "a struct with padding goes through maybe_serializer");
+static_assert(Maybe_Detail::IsRawSerialized<Zeroed>::value, "unless it is declared zero padded");
+static_assert(!Maybe_Detail::IsRawSerialized<std::string>::value, "a string goes through maybe_serializer");
+
+namespace
+{
+  //a Padded whose padding bytes hold fill
+  Padded* padded(void* where, unsigned char fill, char tag, int count) {
+      std::memset(where, fill, sizeof(Padded));
+      Padded* p = static_cast<Padded*>(where);
+      p->tag = tag;
+      p->count = count;
+      return p;
+  }
+
+  std::vector<unsigned char> written(const Padded& p) {
+      std::vector<unsigned char> buf;
+      MaybeWriter<> out(buf);
+      out.write(Maybe<Padded>(p));
+      MaybeVector<Padded> column;
+      column.push_back(p);
+      column.push_back(nullptr);
+      out.write(column);
+      return buf;
+  }
+
+  void padding() {
+      alignas(Padded) unsigned char first[sizeof(Padded)];
+      alignas(Padded) unsigned char second[sizeof(Padded)];
+      std::vector<unsigned char> a = written(*padded(first, 0x00, 'x', 7));
+      std::vector<unsigned char> b = written(*padded(second, 0xff, 'x', 7));
+      check(a == b, "equal padded values give equal bytes, whatever their padding holds");
+
+      MaybeReader in(a.data(), a.size());
+      Maybe<Padded> m = in.read<Padded>();
+      check(m && m->tag == 'x' && m->count == 7, "a padded value reads back");
+      MaybeVector<Padded> column = in.readVector<Padded>();
+      check(column.size() == 2 && column[0] && column[0]->count == 7 && !column[1], "a padded column reads back");
+      check(in.exhausted(), "and nothing is left over");
+
+      std::vector<unsigned char> buf;
+      MaybeWriter<> out(buf);
+      Dense d = {1, 2};
+      out.write(Maybe<Dense>(d));
+      MaybeReader denseIn(buf.data(), buf.size());
+      Maybe<const Dense&> view = denseIn.view<Dense>();
+      check(view && view->a == 1 && view->b == 2, "a dense struct is still viewed in place");
+  }
+
+  //a stream buffer taking at most limit bytes
+  class Limited : public std::streambuf {
+      std::size_t left;
+
+  protected:
+      int_type overflow(int_type c) override {
+          if (left == 0 || traits_type::eq_int_type(c, traits_type::eof())) {
+              return traits_type::eof();
+          }
+          --left;
+          return c;
+      }
+
+  public:
+      explicit Limited(std::size_t limit) : left(limit) {}
+  };
+
+  void streamFailure() {
+      std::ostringstream good;
+      MaybeWriter<MaybeStreamSink> toGood(good);
+      toGood.write(Maybe<int>(5));
+      toGood.write(Maybe<std::string>("five"));
+      check(toGood.good(), "writing to a healthy stream succeeds");
+      check(good.str().size() == toGood.position(), "and the stream has every byte");
+
+      Limited buffer(3);
+      std::ostream limited(&buffer);
+      MaybeWriter<MaybeStreamSink> toLimited(limited);
+      toLimited.write(Maybe<int>());
+      check(toLimited.good(), "writes the stream takes are fine");
+      toLimited.write(Maybe<int>(5));
+      check(!toLimited.good(), "a write the stream fails is reported");
+      toLimited.write(Maybe<int>());
+      check(!toLimited.good(), "and stays reported");
+
+      std::vector<unsigned char> buf;
+      MaybeWriter<> toBytes(buf);
+      toBytes.write(Maybe<int>(5));
+      check(toBytes.good(), "a sink returning nothing never fails");
+  }
+}
+
+int main() {
+    padding();
+    streamFailure();
+    return failures == 0 ? 0 : 1;
+}
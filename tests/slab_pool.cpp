@@ -0,0 +1,160 @@
+/*
+ * Checks the slab pool behind MaybeSlabBoxed: blocks are distinct,
+ * aligned and reused, can be freed on a thread other than the one that
+ * allocated them, and stay exclusive to their owner while several
+ * threads allocate and free at once.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MaybeSlab.h"
+
+namespace
+{
+  int failures = 0;
+
+  void check(bool ok, const char* what) {
+      if (!ok) {
+          std::fprintf(stderr, "FAILED: %s\n", what);
+          ++failures;
+      }
+  }
+
+  struct alignas(64) Wide {
+      std::uint64_t words[8];
+  };
+
+  //freed by the main thread after its free list cache has gone
+  Maybe<std::string, MaybeSlabBoxed> atExit(std::string(100, 'x'));
+
+  void maybes() {
+      typedef Maybe<std::string, MaybeSlabBoxed> Boxed;
+
+      Boxed a(std::string("slab"));
+      Boxed b = a;
+      check(b && *b == "slab" && &*a != &*b, "a copy gets its own block");
+
+      Boxed c;
+      c = std::move(a);
+      check(c && *c == "slab", "moving keeps the value");
+      b = Boxed();
+      check(!b, "assigning empty frees the block");
+
+      Maybe<Wide, MaybeSlabBoxed> wide(Wide{{1, 2, 3, 4, 5, 6, 7, 8}});
+      check(reinterpret_cast<std::uintptr_t>(&*wide) % 64 == 0 && wide->words[7] == 8,
+            "an over-aligned type gets an aligned block");
+  }
+
+  void blocks() {
+      MaybeSlabAllocator<Wide> alloc;
+
+      Wide* first = alloc.allocate(1);
+      alloc.deallocate(first, 1);
+      Wide* again = alloc.allocate(1);
+      check(again == first, "a freed block is handed out again first");
+      alloc.deallocate(again, 1);
+
+      //enough to need several refills and a few new slabs
+      std::vector<Wide*> held;
+      for (int i = 0; i < 3000; ++i) {
+          held.push_back(alloc.allocate(1));
+      }
+      std::vector<Wide*> sorted = held;
+      std::sort(sorted.begin(), sorted.end());
+      bool apart = true;
+      bool aligned = true;
+      for (std::size_t i = 0; i < sorted.size(); ++i) {
+          aligned = aligned && reinterpret_cast<std::uintptr_t>(sorted[i]) % alignof(Wide) == 0;
+          if (i != 0) {
+              apart = apart && reinterpret_cast<char*>(sorted[i]) - reinterpret_cast<char*>(sorted[i - 1]) >=
+                               static_cast<std::ptrdiff_t>(sizeof(Wide));
+          }
+      }
+      check(apart, "live blocks never overlap");
+      check(aligned, "every block is aligned");
+      for (Wide* p : held) {
+          alloc.deallocate(p, 1);
+      }
+
+      Wide* array = alloc.allocate(4);
+      array[3].words[0] = 1;
+      check(reinterpret_cast<std::uintptr_t>(array) % alignof(Wide) == 0, "arrays come from the heap, aligned");
+      alloc.deallocate(array, 4);
+  }
+
+  //blocks allocated on one thread and freed on another end up back in
+  //circulation, on both
+  void crossThread() {
+      MaybeSlabAllocator<std::uint64_t> alloc;
+      std::vector<std::uint64_t*> handed;
+      std::thread producer([&] {
+          for (int i = 0; i < 1000; ++i) {
+              handed.push_back(alloc.allocate(1));
+              *handed.back() = std::uint64_t(i);
+          }
+      });
+      producer.join();
+
+      bool intact = true;
+      for (std::size_t i = 0; i < handed.size(); ++i) {
+          intact = intact && *handed[i] == i;
+          alloc.deallocate(handed[i], 1);
+      }
+      check(intact, "blocks outlive the thread which allocated them");
+
+      std::thread later([&] {
+          std::vector<std::uint64_t*> mine;
+          for (int i = 0; i < 1000; ++i) {
+              mine.push_back(alloc.allocate(1));
+          }
+          for (std::uint64_t* p : mine) {
+              alloc.deallocate(p, 1);
+          }
+      });
+      later.join();
+  }
+
+  //each thread stamps its blocks with its own id and checks the stamps
+  //before freeing them, so a block handed to two threads at once shows
+  void churn() {
+      std::vector<std::thread> threads;
+      std::vector<int> clashes(4, 0);
+      for (int t = 0; t < 4; ++t) {
+          threads.emplace_back([t, &clashes] {
+              MaybeSlabAllocator<std::uint64_t> alloc;
+              std::vector<std::uint64_t*> held;
+              for (int round = 0; round < 200; ++round) {
+                  for (int i = 0; i < 100; ++i) {
+                      held.push_back(alloc.allocate(1));
+                      *held.back() = std::uint64_t(t) << 32 | std::uint64_t(i);
+                  }
+                  for (std::size_t i = 0; i < held.size(); ++i) {
+                      if (*held[i] != (std::uint64_t(t) << 32 | i)) {
+                          ++clashes[t];
+                      }
+                      alloc.deallocate(held[i], 1);
+                  }
+                  held.clear();
+              }
+          });
+      }
+      for (std::thread& t : threads) {
+          t.join();
+      }
+      check(std::count(clashes.begin(), clashes.end(), 0) == 4, "no block is held by two threads at once");
+  }
+}
+
+int main() {
+    check(atExit && atExit->size() == 100, "a static boxed Maybe is built before main");
+    maybes();
+    blocks();
+    crossThread();
+    churn();
+    return failures == 0 ? 0 : 1;
+}
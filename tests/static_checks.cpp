@@ -0,0 +1,50 @@
+/*
+ * Compile-time checks on the traits of the library's types. Nothing in
+ * here runs; the file only has to compile.
+ */
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+#include "Expected.h"
+#include "Maybe.h"
+#include "MaybePack.h"
+
+// Inline Maybes of trivial types must stay trivial, so that arrays of
+// them can be memcpy'd and they can be passed around in registers.
+static_assert(std::is_trivially_copyable<Maybe<int> >::value, "Maybe<int> should be trivially copyable");
+static_assert(std::is_trivially_destructible<Maybe<int> >::value, "Maybe<int> should be trivially destructible");
+static_assert(std::is_trivially_copyable<Maybe<int*> >::value, "Maybe<int*> should be trivially copyable");
+static_assert(!std::is_trivially_copyable<Maybe<int, MaybeBoxed<> > >::value, "boxed Maybes own their value");
+static_assert(std::is_nothrow_move_constructible<Maybe<int, MaybeBoxed<> > >::value, "boxed moves should not throw");
+static_assert(std::is_nothrow_move_assignable<Maybe<int, MaybeBoxed<> > >::value, "boxed moves should not throw");
+static_assert(maybe_trivially_relocatable<Maybe<int, MaybeBoxed<> > >::value, "a boxed Maybe is just a pointer");
+
+// Boxed Maybes only claim the copies T can make, but move by handing
+// the pointer over, so even a boxed Maybe of an immovable T moves.
+static_assert(!std::is_copy_constructible<Maybe<std::unique_ptr<int>, MaybeBoxed<> > >::value, "a boxed move-only Maybe can't be copied");
+static_assert(!std::is_copy_assignable<Maybe<std::unique_ptr<int>, MaybeBoxed<> > >::value, "a boxed move-only Maybe can't be copied");
+static_assert(std::is_nothrow_move_constructible<Maybe<std::unique_ptr<int>, MaybeBoxed<> > >::value, "a boxed move-only Maybe moves");
+static_assert(std::is_nothrow_move_assignable<Maybe<std::unique_ptr<int>, MaybeBoxed<> > >::value, "a boxed move-only Maybe moves");
+static_assert(std::is_copy_assignable<Maybe<std::string, MaybeBoxed<> > >::value, "a boxed copyable Maybe can be copied");
+static_assert(std::is_move_assignable<Maybe<std::mutex, MaybeBoxed<> > >::value, "a boxed Maybe moves its pointer, not its value");
+static_assert(!std::is_copy_constructible<Maybe<std::mutex, MaybeBoxed<> > >::value, "a boxed immovable Maybe can't be copied");
+static_assert(sizeof(Maybe<int&>) == sizeof(int*), "Maybe<T&> should be just a pointer");
+static_assert(std::is_trivially_copyable<Maybe<int&> >::value, "Maybe<T&> should be trivially copyable");
+
+static_assert(std::is_trivially_copyable<Expected<int, int> >::value, "Expected<int, int> should be trivially copyable");
+static_assert(std::is_trivially_destructible<Expected<int, int> >::value, "Expected<int, int> should be trivially destructible");
+
+// Neither a Maybe nor an Expected of another type may reach T through its
+// conversion to bool; the first needs an error, the second converts
+// alternative by alternative.
+static_assert(!std::is_constructible<Expected<bool, int>, Maybe<int> >::value, "a Maybe is not an Expected's value");
+static_assert(!std::is_constructible<Expected<bool, int>, Expected<std::string, int> >::value, "Expected<std::string, int> is not a bool");
+static_assert(std::is_convertible<Expected<int, int>, Expected<long, long> >::value, "Expecteds convert like their types");
+static_assert(std::is_constructible<Expected<Maybe<int>, int>, Maybe<int> >::value, "an Expected of a Maybe wraps one");
+
+static_assert(sizeof(MaybePack<std::int32_t, float, std::uint16_t>) == 12, "MaybePack should pack its fields");
+static_assert(std::is_trivially_copyable<MaybePack<int, float> >::value, "MaybePack should be trivially copyable");
@@ -0,0 +1,229 @@
+/*
+ * Checks the MaybeVectorOps kernels against an element by element
+ * reference, for every instruction set this CPU has, over lengths
+ * which end mid-word and outputs which are not vector aligned. The
+ * bitmaps mix all-empty, all-full and mixed words so each shortcut is
+ * taken.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "MaybeVectorOps.h"
+
+namespace
+{
+  int failures = 0;
+
+  void check(bool ok, const char* what) {
+      if (!ok) {
+          std::fprintf(stderr, "FAILED: %s\n", what);
+          ++failures;
+      }
+  }
+
+  enum Colour { Red, Green, Blue };
+
+  const std::size_t lengths[] = {0, 1, 63, 64, 65, 191, 200};
+
+  std::uint32_t next(std::uint32_t& seed) {
+      seed = seed * 1664525u + 1013904223u;
+      return seed >> 8;
+  }
+
+  template <typename T>
+  T make(std::uint32_t r) {
+      if constexpr (std::is_same<T, bool>::value) {
+          return (r & 1) != 0;
+      } else if constexpr (std::is_same<T, std::string>::value) {
+          return std::string(1, char('a' + r % 4));
+      } else {
+          return static_cast<T>(r % 3);
+      }
+  }
+
+  //word w of the bitmap is empty, full or mixed by w % 3, so the
+  //vector's values are small enough for the two sides to match often
+  template <typename T>
+  MaybeVector<T> column(std::size_t n, std::uint32_t seed) {
+      MaybeVector<T> v;
+      for (std::size_t i = 0; i < n; ++i) {
+          std::uint32_t r = next(seed);
+          std::size_t kind = (i / 64 + seed % 2) % 3;
+          if (kind == 1 || (kind == 2 && (r & 2))) {
+              v.push_back(make<T>(r));
+          } else {
+              v.push_back(nullptr);
+              if constexpr (std::is_trivially_destructible<T>::value) {
+                  //leave something other than T() in the empty slot
+                  v.data()[i] = make<T>(r + 1);
+              }
+          }
+      }
+      return v;
+  }
+
+  template <typename T>
+  bool sameValues(const T* out, const MaybeVector<T>& v, const T& def) {
+      for (std::size_t i = 0; i < v.size(); ++i) {
+          if (!(out[i] == (v[i] ? *v[i] : def))) {
+              return false;
+          }
+      }
+      return true;
+  }
+
+  template <typename T>
+  bool sameCoalesce(const T* out, const MaybeVector<T>& a, const MaybeVector<T>& b) {
+      for (std::size_t i = 0; i < a.size(); ++i) {
+          if (a[i] ? !(out[i] == *a[i]) : b[i] && !(out[i] == *b[i])) {
+              return false;
+          }
+      }
+      return true;
+  }
+
+  template <typename T, typename oT>
+  bool sameEqual(const std::vector<std::uint64_t>& bits, const MaybeVector<T>& a, const MaybeVector<oT>& b) {
+      for (std::size_t i = 0; i < a.size(); ++i) {
+          bool bit = (bits[i / 64] >> (i % 64)) & 1;
+          if (bit != (a[i] == b[i])) {
+              return false;
+          }
+      }
+      for (std::size_t i = a.size(); i < bits.size() * 64; ++i) {
+          if ((bits[i / 64] >> (i % 64)) & 1) {
+              return false;
+          }
+      }
+      return true;
+  }
+
+  //the raw kernels for one instruction set, writing one element past an
+  //aligned start so vector stores are unaligned
+  template <typename T>
+  void kernels(MaybeVector_Detail::Isa isa, const char* name) {
+      using namespace MaybeVector_Detail;
+      for (std::size_t n : lengths) {
+          MaybeVector<T> a = column<T>(n, 1);
+          MaybeVector<T> b = column<T>(n, 2);
+          T def = make<T>(7);
+
+          std::vector<T> values(n + 1);
+          std::vector<T> merged(n + 1);
+          std::vector<word_type> both(a.bitmapWords());
+          for (std::size_t w = 0; w < both.size(); ++w) {
+              both[w] = a.bitmap()[w] & b.bitmap()[w];
+          }
+          std::vector<word_type> eq(both.size());
+
+          switch (isa) {
+          case Isa::Generic:
+              valueOrLoop(a.data(), a.bitmap(), n, def, values.data() + 1);
+              coalesceLoop(a.data(), a.bitmap(), b.data(), n, merged.data() + 1);
+              equalLoop(a.data(), b.data(), both.data(), n, eq.data());
+              break;
+#if MAYBE_X86_DISPATCH
+          case Isa::Avx2:
+              valueOrAvx2(a.data(), a.bitmap(), n, def, values.data() + 1);
+              coalesceAvx2(a.data(), a.bitmap(), b.data(), n, merged.data() + 1);
+              equalAvx2(a.data(), b.data(), both.data(), n, eq.data());
+              break;
+          case Isa::Avx512:
+              valueOrAvx512(a.data(), a.bitmap(), n, def, values.data() + 1);
+              coalesceAvx512(a.data(), a.bitmap(), b.data(), n, merged.data() + 1);
+              equalAvx512(a.data(), b.data(), both.data(), n, eq.data());
+              break;
+#else
+          default:
+              return;
+#endif
+          }
+
+          check(sameValues(values.data() + 1, a, def), name);
+          check(sameCoalesce(merged.data() + 1, a, b), name);
+          bool eqOk = true;
+          for (std::size_t i = 0; i < n; ++i) {
+              if (((both[i / 64] >> (i % 64)) & 1) && ((eq[i / 64] >> (i % 64)) & 1) != (*a[i] == *b[i])) {
+                  eqOk = false;
+              }
+          }
+          check(eqOk, name);
+      }
+  }
+
+  template <typename T>
+  void everyIsa() {
+      using MaybeVector_Detail::Isa;
+      kernels<T>(Isa::Generic, "the generic kernels match the reference");
+#if MAYBE_X86_DISPATCH
+      if (__builtin_cpu_supports("avx2")) {
+          kernels<T>(Isa::Avx2, "the AVX2 kernels match the reference");
+      }
+      if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+          kernels<T>(Isa::Avx512, "the AVX-512 kernels match the reference");
+      }
+#endif
+  }
+
+  //the public functions, through whichever kernels get dispatched to
+  template <typename T, typename oT = T>
+  void operations() {
+      for (std::size_t n : lengths) {
+          MaybeVector<T> a = column<T>(n, 1);
+          MaybeVector<T> b = column<T>(n, 2);
+          MaybeVector<oT> c = column<oT>(n, 2);
+          T def = make<T>(7);
+
+          std::size_t engaged = 0;
+          for (std::size_t i = 0; i < n; ++i) {
+              engaged += a[i] ? 1 : 0;
+          }
+          check(maybe_count_engaged(a) == engaged, "maybe_count_engaged counts the engaged elements");
+
+          std::vector<T> values = maybe_value_or(a, def);
+          bool valuesOk = values.size() == n;
+          for (std::size_t i = 0; valuesOk && i < n; ++i) {
+              valuesOk = values[i] == (a[i] ? *a[i] : def);
+          }
+          check(valuesOk, "maybe_value_or fills in the default");
+
+          MaybeVector<T> merged = maybe_coalesce(a, b);
+          bool mergedOk = merged.size() == n;
+          for (std::size_t i = 0; mergedOk && i < n; ++i) {
+              mergedOk = merged[i] == (a[i] ? a[i] : b[i]);
+          }
+          check(mergedOk, "maybe_coalesce falls back to the second vector, empty only where both are");
+
+          check(sameEqual(maybe_equal(a, b), a, b), "maybe_equal has Maybe's truth table");
+          check(sameEqual(maybe_equal(a, c), a, c), "maybe_equal has Maybe's truth table across types");
+      }
+  }
+}
+
+int main() {
+    everyIsa<std::int8_t>();
+    everyIsa<int>();
+    everyIsa<std::int64_t>();
+    everyIsa<double>();
+    everyIsa<Colour>();
+
+    operations<std::int8_t>();
+    operations<int, long>();
+    operations<double, float>();
+    operations<Colour>();
+    operations<bool>();
+    operations<std::string>();
+
+    bool threw = false;
+    try {
+        maybe_coalesce(MaybeVector<int>(3), MaybeVector<int>(4));
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    check(threw, "mismatched sizes are rejected");
+
+    return failures == 0 ? 0 : 1;
+}